@@ -0,0 +1,43 @@
+#pragma once
+
+// Replaces the global operator new/delete to count heap allocations and bytes.
+// Include in exactly one source file of the executable that wants the count.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+inline std::atomic<size_t> allocation_count{0};
+// Bytes currently held through operator new, and the most it has reached
+inline std::atomic<size_t> allocated_bytes{0};
+inline std::atomic<size_t> peak_allocated_bytes{0};
+
+// Each block starts with its size so delete knows how much is given back
+constexpr size_t AllocHeaderSize = alignof(std::max_align_t);
+
+void* operator new(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (auto* block = static_cast<char*>(std::malloc(size + AllocHeaderSize))) {
+        *reinterpret_cast<size_t*>(block) = size;
+        size_t now = allocated_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+        size_t peak = peak_allocated_bytes.load(std::memory_order_relaxed);
+        while (now > peak && !peak_allocated_bytes.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {}
+        return block + AllocHeaderSize;
+    }
+    throw std::bad_alloc{};
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    if (!ptr) return;
+    auto* block = static_cast<char*>(ptr) - AllocHeaderSize;
+    allocated_bytes.fetch_sub(*reinterpret_cast<size_t*>(block), std::memory_order_relaxed);
+    std::free(block);
+}
+void operator delete[](void* ptr) noexcept { operator delete(ptr); }
+void operator delete(void* ptr, size_t) noexcept { operator delete(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { operator delete(ptr); }
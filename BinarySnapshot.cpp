@@ -0,0 +1,216 @@
+#include "BinarySnapshot.h"
+
+#include <bit>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+template <class T>
+static T read_le(const char* data) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, data, sizeof(T));
+    if constexpr (std::endian::native == std::endian::big) std::reverse(bytes, bytes + sizeof(T));
+    T value;
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+template <class T>
+static void write_le(std::string& out, T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    if constexpr (std::endian::native == std::endian::big) std::reverse(bytes, bytes + sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+bool TimerBin::readHeader(const char* data, size_t size, Header& header) {
+    if (size < HeaderSize || std::memcmp(data, Magic, sizeof(Magic)) != 0) return false;
+    header.version = read_le<uint32_t>(data + 4);
+    header.headerSize = read_le<uint32_t>(data + 8);
+    header.recordSize = read_le<uint32_t>(data + 12);
+    header.count = read_le<uint32_t>(data + 16);
+    header.heapSize = read_le<uint64_t>(data + 20);
+    if (header.version >> 16 != Major || (header.version & 0xFFFF) == 0) return false;
+    if (header.headerSize < HeaderSize || header.recordSize < RecordSize) return false;
+    uint64_t tables = uint64_t(header.headerSize) + uint64_t(header.recordSize) * header.count;
+    return tables <= size && header.heapSize <= size - tables;
+}
+
+TimerBin::Record TimerBin::readRecord(const char* data, const Header& header, size_t ind) {
+    const char* p = data + header.headerSize + ind * header.recordSize;
+    Record record;
+    record.nameOffset = read_le<uint32_t>(p);
+    record.nameLength = read_le<uint32_t>(p + 4);
+    record.duration = read_le<int64_t>(p + 8);
+    record.timePassed = read_le<int64_t>(p + 16);
+    for (int c = 0; c < 3; c++) record.color[c] = read_le<float>(p + 24 + c * 4);
+    record.days = uint8_t(p[36]);
+    record.type = uint8_t(p[37]);
+    record.interval = read_le<uint16_t>(p + 38);
+    return record;
+}
+
+bool TimerBin::validRecord(const Header& header, const Record& record) {
+    return uint64_t(record.nameOffset) + record.nameLength <= header.heapSize &&
+           record.type < std::size(PeriodTypeNames) && record.interval != 0;
+}
+
+std::string_view TimerBin::recordName(const char* data, const Header& header, const Record& record) {
+    const char* heap = data + header.headerSize + size_t(header.recordSize) * header.count;
+    return std::string_view(heap + record.nameOffset, record.nameLength);
+}
+
+std::string TimerBin::encode(const std::vector<Timer>& timers) {
+    size_t heapSize = 0;
+    for (auto& timer : timers) heapSize += timer.name.size();
+
+    std::string out;
+    out.reserve(HeaderSize + timers.size() * RecordSize + heapSize);
+    out.append(Magic, sizeof(Magic));
+    write_le(out, Version);
+    write_le(out, HeaderSize);
+    write_le(out, RecordSize);
+    write_le(out, uint32_t(timers.size()));
+    write_le(out, uint64_t(heapSize));
+
+    uint32_t nameOffset = 0;
+    for (auto& timer : timers) {
+        write_le(out, nameOffset);
+        write_le(out, uint32_t(timer.name.size()));
+        write_le(out, int64_t(timer.duration.count()));
+        write_le(out, int64_t(timer.timePassed.count()));
+        write_le(out, timer.timerColor.r);
+        write_le(out, timer.timerColor.g);
+        write_le(out, timer.timerColor.b);
+        out.push_back(char(timer.days));
+        out.push_back(char(timer.type.type));
+        write_le(out, timer.type.interval);
+        nameOffset += uint32_t(timer.name.size());
+    }
+    for (auto& timer : timers) out += timer.name;
+    return out;
+}
+
+bool save_timer_bin(const std::vector<Timer>& timers, const std::filesystem::path& path) {
+    return atomic_write_file(path, TimerBin::encode(timers));
+}
+
+static void assign_timer(Timer& timer, std::string_view name, const TimerBin::Record& record) {
+    timer.name.assign(name);
+    make_valid_utf8(timer.name);
+    timer.duration = std::chrono::seconds(record.duration);
+    timer.timePassed = std::chrono::milliseconds(record.timePassed);
+    timer.timerColor = Color{record.color[0], record.color[1], record.color[2]};
+    timer.days = WeekDays(record.days & AllWeekDays);
+    timer.type = Period{PeriodType(record.type), record.interval};
+}
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+#ifdef _WIN32
+    HANDLE handle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) return;
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(handle, &fileSize) && fileSize.QuadPart > 0) {
+        mapping = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            if (data) size = size_t(fileSize.QuadPart);
+        }
+    }
+    // The mapping keeps the file open
+    CloseHandle(handle);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat info;
+    if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* ptr = ::mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr != MAP_FAILED) {
+            data = static_cast<const char*>(ptr);
+            size = size_t(info.st_size);
+        }
+    }
+    // The mapping stays valid after close
+    ::close(fd);
+#endif
+}
+
+MappedFile::~MappedFile() { unmap(); }
+
+MappedFile::MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this == &other) return *this;
+    unmap();
+    data = std::exchange(other.data, nullptr);
+    size = std::exchange(other.size, 0);
+#ifdef _WIN32
+    mapping = std::exchange(other.mapping, nullptr);
+#endif
+    return *this;
+}
+
+void MappedFile::unmap() {
+#ifdef _WIN32
+    if (data) UnmapViewOfFile(data);
+    if (mapping) CloseHandle(mapping);
+    mapping = nullptr;
+#else
+    if (data) ::munmap(const_cast<char*>(data), size);
+#endif
+    data = nullptr;
+    size = 0;
+}
+
+bool TimerBinView::open(const std::filesystem::path& path) {
+    file = MappedFile(path);
+    header = {};
+    if (file.data && TimerBin::readHeader(file.data, file.size, header)) return true;
+    header = {};
+    return false;
+}
+
+Timer TimerBinView::get(size_t ind) const {
+    Timer timer{"", {}, Color{0, 0, 0}, 0, {}};
+    auto rec = record(ind);
+    assign_timer(timer, TimerBin::recordName(file.data, header, rec), rec);
+    return timer;
+}
+
+TimerHandle TimerBinView::materialize(TimerStore& timers, size_t ind) const {
+    if (!valid(ind)) return NullTimer;
+    // Looked up by the fixed name, that's the one the store has
+    Timer timer = get(ind);
+    TimerHandle existing = timers.find(timer.name);
+    if (existing != NullTimer) return existing;
+    return timers.push_back(timer);
+}
+
+bool load_timer_bin(TimerStore& timers, const std::filesystem::path& path) {
+    TimerBinView view;
+    if (!view.open(path)) return false;
+    for (size_t ind = 0; ind < view.size(); ind++) {
+        if (!view.valid(ind)) return false;
+    }
+
+    timers.reserve(timers.size() + view.size());
+    // Reused so the name buffer is only allocated once
+    Timer timer{"", {}, Color{0, 0, 0}, 0, {}};
+    for (size_t ind = 0; ind < view.size(); ind++) {
+        auto rec = view.record(ind);
+        assign_timer(timer, TimerBin::recordName(view.file.data, view.header, rec), rec);
+        if (timers.find(timer.name) != NullTimer) timer.name = timers.uniqueName(timer.name);
+        timers.push_back(timer);
+    }
+    return true;
+}
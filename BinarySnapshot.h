@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "TimerWise.h"
+
+// timers.bin, a binary copy of timers.json that loads without a JSON parse.
+// Everything is little-endian:
+//   header   "TWSN" then the Header fields
+//   records  count * recordSize bytes, the Record fields in order
+//   heap     heapSize bytes of names, not null terminated
+// The version is major << 16 | minor. A new minor version may only append
+// fields to the header or to a record, readers of an older minor skip what
+// they don't know by going by headerSize and recordSize. Any other change
+// bumps the major version, and files from another major are rejected.
+struct TimerBin {
+    static constexpr char Magic[4] = {'T', 'W', 'S', 'N'};
+    static constexpr uint32_t Major = 0;
+    static constexpr uint32_t Minor = 1;
+    static constexpr uint32_t Version = Major << 16 | Minor;
+
+    struct Header {
+        uint32_t version;
+        uint32_t headerSize;
+        uint32_t recordSize;
+        uint32_t count;
+        uint64_t heapSize;
+    };
+    static constexpr uint32_t HeaderSize = 4 + 4 * 4 + 8;
+
+    struct Record {
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        // Seconds
+        int64_t duration;
+        // Milliseconds
+        int64_t timePassed;
+        float color[3];
+        uint8_t days;
+        uint8_t type;
+        uint16_t interval;
+    };
+    static constexpr uint32_t RecordSize = 4 + 4 + 8 + 8 + 3 * 4 + 1 + 1 + 2;
+
+    // Checks the header and that the tables fit in size bytes
+    static bool readHeader(const char* data, size_t size, Header& header);
+    static Record readRecord(const char* data, const Header& header, size_t ind);
+    // Name inside the heap and a known period type
+    static bool validRecord(const Header& header, const Record& record);
+    static std::string_view recordName(const char* data, const Header& header, const Record& record);
+
+    static std::string encode(const std::vector<Timer>& timers);
+};
+
+// Read-only mapping of a whole file, empty when it couldn't be mapped
+struct MappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+
+    MappedFile() = default;
+    explicit MappedFile(const std::filesystem::path& path);
+    ~MappedFile();
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+private:
+    void unmap();
+#ifdef _WIN32
+    void* mapping = nullptr;
+#endif
+};
+
+// Timers read straight out of a mapped timers.bin. Opening only checks the
+// header, so it takes the same time for any number of timers. Records are
+// decoded when asked for, and names point into the mapping, so they are
+// valid as long as the view is alive.
+struct TimerBinView {
+    MappedFile file;
+    TimerBin::Header header{};
+
+    bool open(const std::filesystem::path& path);
+    size_t size() const { return header.count; }
+
+    TimerBin::Record record(size_t ind) const { return TimerBin::readRecord(file.data, header, ind); }
+    bool valid(size_t ind) const { return TimerBin::validRecord(header, record(ind)); }
+    // Only for valid records
+    std::string_view name(size_t ind) const { return TimerBin::recordName(file.data, header, record(ind)); }
+    std::chrono::seconds duration(size_t ind) const { return std::chrono::seconds(record(ind).duration); }
+    std::chrono::milliseconds timePassed(size_t ind) const { return std::chrono::milliseconds(record(ind).timePassed); }
+    Timer get(size_t ind) const;
+
+    // Copies a timer into the store the first time it's needed there, e.g.
+    // when it's edited or started. NullTimer for a damaged record.
+    TimerHandle materialize(TimerStore& timers, size_t ind) const;
+};
+
+bool save_timer_bin(const std::vector<Timer>& timers, const std::filesystem::path& path);
+// False when the file is missing, from another major version or damaged. The
+// store is left untouched then and the caller should fall back to JSON.
+bool load_timer_bin(TimerStore& timers, const std::filesystem::path& path);
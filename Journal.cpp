@@ -0,0 +1,137 @@
+#include "Journal.h"
+
+#include <string>
+
+bool Journal::open(const std::filesystem::path& journalPath) {
+    path = journalPath;
+    out.open(path, std::ofstream::app);
+    records = 0;
+    changes = 0;
+    return out.is_open();
+}
+
+void Journal::add(const TimerStore& timers, size_t ind) {
+    append({{"op", "add"}, {"timer", timers.get(ind).to_json()}});
+}
+
+void Journal::edit(std::string_view oldName, const TimerStore& timers, size_t ind) {
+    append({{"op", "edit"}, {"name", oldName}, {"timer", timers.get(ind).to_json()}});
+}
+
+void Journal::remove(const TimerStore& timers, size_t ind) {
+    append({{"op", "remove"}, {"name", timers.meta[ind].name}});
+}
+
+void Journal::start(const TimerStore& timers, size_t ind) { elapsedRecord("start", timers, ind); }
+void Journal::pause(const TimerStore& timers, size_t ind) { elapsedRecord("pause", timers, ind); }
+void Journal::complete(const TimerStore& timers, size_t ind) { elapsedRecord("complete", timers, ind); }
+void Journal::progress(const TimerStore& timers, size_t ind) { elapsedRecord("progress", timers, ind, false); }
+
+void Journal::rollover() {
+    append({{"op", "rollover"},
+            {"date", {Timer::cur_day, Timer::cur_week, Timer::cur_month, Timer::cur_epoch_day}}});
+}
+
+void Journal::rotate() {
+    out.close();
+    auto retired = retiredPath(path);
+    std::error_code error;
+    bool moved;
+    if (!std::filesystem::exists(retired)) {
+        std::filesystem::rename(path, retired, error);
+        moved = !error;
+    } else {
+        // The previous snapshot never made it to disk, keep both sets of records
+        std::ofstream merged(retired, std::ofstream::app | std::ofstream::binary);
+        std::ifstream current(path, std::ifstream::binary);
+        // Streaming an empty rdbuf() sets failbit
+        if (current.peek() != std::ifstream::traits_type::eof()) merged << current.rdbuf();
+        merged.flush();
+        moved = bool(merged);
+    }
+    if (!moved) {
+        out.open(path, std::ofstream::app);
+        return;
+    }
+    out.open(path, std::ofstream::trunc);
+    records = 0;
+    changes = 0;
+}
+
+std::filesystem::path Journal::retiredPath(const std::filesystem::path& journalPath) {
+    auto retired = journalPath;
+    retired += ".old";
+    return retired;
+}
+
+void Journal::elapsedRecord(const char* op, const TimerStore& timers, size_t ind, bool change) {
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(timers.elapsed(ind));
+    append({{"op", op}, {"name", timers.meta[ind].name}, {"elapsed", elapsed.count()}}, change);
+}
+
+void Journal::append(const nlohmann::json& record, bool change) {
+    if (!out.is_open()) return;
+    // Flushed right away so a killed process loses at most the record being written
+    // Names are valid UTF-8 once loaded, this only guards against a throw
+    out << record.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace) << '\n';
+    out.flush();
+    records++;
+    if (change) changes++;
+}
+
+static size_t replay_file(TimerStore& timers, const std::filesystem::path& path) {
+    std::ifstream f(path);
+    if (!f.is_open()) return 0;
+
+    size_t applied = 0;
+    std::string line;
+    while (std::getline(f, line)) {
+        auto record = nlohmann::json::parse(line, nullptr, false);
+        if (record.is_discarded() || !record.is_object() || !record.contains("op")) break;
+        try {
+            const std::string& op = record["op"].get_ref<const std::string&>();
+
+            if (op == "add" || op == "edit") {
+                Timer timer(record.at("timer"));
+                // Already applied, or the snapshot was written after the record
+                TimerHandle handle = timers.find(timer.name);
+                if (op == "edit") {
+                    TimerHandle old = timers.find(record.at("name").get_ref<const std::string&>());
+                    if (handle == NullTimer) {
+                        handle = old;
+                    } else if (old != handle) {
+                        // Brought back by replaying its add record over a snapshot that has the rename
+                        timers.erase(old);
+                    }
+                }
+                if (handle == NullTimer) {
+                    timers.push_back(timer);
+                } else {
+                    timers.set(timers.indexOf(handle), timer);
+                }
+            } else if (op == "remove") {
+                timers.erase(timers.find(record.at("name").get_ref<const std::string&>()));
+            } else if (op == "start" || op == "pause" || op == "complete" || op == "progress") {
+                size_t ind = timers.indexOf(timers.find(record.at("name").get_ref<const std::string&>()));
+                // Running time is only journaled once per progress interval, a restarted app resumes with the timer paused
+                if (ind != TimerStore::NotFound) timers.timePassed[ind] = std::chrono::milliseconds(record.at("elapsed").get<int64_t>());
+            } else if (op == "rollover") {
+                auto& date = record.at("date");
+                CalendarDate calendar{};
+                calendar.yday = date.at(0);
+                calendar.week = date.at(1);
+                calendar.month = date.at(2);
+                calendar.epochDay = date.at(3);
+                reset_timer_vec(timers, calendar);
+            }
+        } catch (const nlohmann::json::exception&) {
+            break;
+        }
+        applied++;
+    }
+    return applied;
+}
+
+size_t replay_journal(TimerStore& timers, const std::filesystem::path& path) {
+    return replay_file(timers, Journal::retiredPath(path)) + replay_file(timers, path);
+}
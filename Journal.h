@@ -0,0 +1,52 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+
+#include "TimerWise.h"
+
+// Append-only log of timer changes made since the last snapshot (timers.json
+// and days.txt). Every record is one compact JSON object on its own line.
+// Timers are identified by name because handles don't survive a restart.
+// Records hold absolute values, so replaying one twice changes nothing.
+struct Journal {
+    // Records after which the caller should rotate() and write a snapshot
+    static constexpr size_t CheckpointRecords = 1024;
+
+    std::filesystem::path path;
+    std::ofstream out;
+    size_t records = 0;
+    // Records that changed a timer, progress records don't count
+    size_t changes = 0;
+
+    bool open(const std::filesystem::path& journalPath);
+
+    void add(const TimerStore& timers, size_t ind);
+    // oldName is needed when the edit renamed the timer
+    void edit(std::string_view oldName, const TimerStore& timers, size_t ind);
+    void remove(const TimerStore& timers, size_t ind);
+    void start(const TimerStore& timers, size_t ind);
+    void pause(const TimerStore& timers, size_t ind);
+    void complete(const TimerStore& timers, size_t ind);
+    // Elapsed time of a running timer, so a crash loses at most one interval of it
+    void progress(const TimerStore& timers, size_t ind);
+    // After reset_timer_vec, so replay resets at the same point
+    void rollover();
+
+    bool needsCheckpoint() const { return records >= CheckpointRecords; }
+    // Moves the records so far to retiredPath() and starts an empty journal.
+    // For snapshots written in the background: the retired records are removed
+    // once the snapshot is on disk, until then replay still sees them.
+    void rotate();
+    static std::filesystem::path retiredPath(const std::filesystem::path& journalPath);
+
+private:
+    void elapsedRecord(const char* op, const TimerStore& timers, size_t ind, bool change = true);
+    void append(const nlohmann::json& record, bool change = true);
+};
+
+// Applies the journal at path, after its retired records, on top of an already
+// loaded snapshot. Stops at the first line that doesn't parse, which is where
+// a crash cut the last append short. Returns how many records were applied.
+size_t replay_journal(TimerStore& timers, const std::filesystem::path& path);
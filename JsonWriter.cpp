@@ -0,0 +1,168 @@
+#include "JsonWriter.h"
+
+#include <charconv>
+#include <cmath>
+
+TimerJsonWriter::TimerJsonWriter(AtomicFile& file, JsonStyle style) : file(file), style(style) {
+    buffer.reserve(BufferSize);
+    put('[');
+}
+
+void TimerJsonWriter::write(const Timer& timer) {
+    write(timer.name, timer.duration, std::chrono::duration_cast<std::chrono::seconds>(timer.timePassed),
+          timer.timerColor, timer.days, timer.type);
+}
+
+void TimerJsonWriter::write(std::string_view name, std::chrono::seconds duration, std::chrono::seconds timePassed,
+                            const Color& color, WeekDays days, Period period) {
+    if (count++ != 0) put(',');
+    newline(1);
+    put('{');
+
+    key("color", 2);
+    put('[');
+    float channels[3] = {color.r, color.g, color.b};
+    for (int c = 0; c < 3; c++) {
+        if (c != 0) put(',');
+        newline(3);
+        putFloat(channels[c]);
+    }
+    newline(2);
+    put(']');
+
+    put(',');
+    key("days", 2);
+    put('[');
+    bool anyDay = false;
+    for (int wday = 0; wday < 7; wday++) {
+        if (!(days & weekday_bit(wday))) continue;
+        if (anyDay) put(',');
+        newline(3);
+        putString(DaysOfWeek[wday]);
+        anyDay = true;
+    }
+    // dump(4) writes an empty array as []
+    if (anyDay) newline(2);
+    put(']');
+
+    put(',');
+    key("duration", 2);
+    putInt(duration.count());
+
+    if (period.type == PeriodType::EveryNDays) {
+        put(',');
+        key("interval", 2);
+        putInt(period.interval);
+    }
+
+    put(',');
+    key("name", 2);
+    putString(name);
+
+    put(',');
+    key("timePassed", 2);
+    putInt(timePassed.count());
+
+    put(',');
+    key("type", 2);
+    putString(PeriodTypeNames[int(period.type)]);
+
+    newline(1);
+    put('}');
+}
+
+bool TimerJsonWriter::finish() {
+    if (count != 0) newline(0);
+    put(']');
+    flush();
+    return file.ok;
+}
+
+void TimerJsonWriter::put(std::string_view text) {
+    if (buffer.size() + text.size() > BufferSize) flush();
+    if (text.size() > BufferSize) {
+        file.write(text);
+        return;
+    }
+    buffer.append(text);
+}
+
+void TimerJsonWriter::put(char c) {
+    if (buffer.size() == BufferSize) flush();
+    buffer.push_back(c);
+}
+
+void TimerJsonWriter::newline(int indent) {
+    if (style == JsonStyle::Compact) return;
+    put('\n');
+    for (int i = 0; i < indent; i++) put("    ");
+}
+
+void TimerJsonWriter::key(std::string_view name, int indent) {
+    newline(indent);
+    putString(name);
+    put(style == JsonStyle::Compact ? ":" : ": ");
+}
+
+// Escapes like nlohmann does, invalid UTF-8 becomes U+FFFD so the file still loads
+void TimerJsonWriter::putString(std::string_view text) {
+    put('"');
+    for (size_t i = 0; i < text.size();) {
+        auto c = uint8_t(text[i]);
+        if (c < 0x80) {
+            switch (c) {
+            case '"': put("\\\""); break;
+            case '\\': put("\\\\"); break;
+            case '\b': put("\\b"); break;
+            case '\f': put("\\f"); break;
+            case '\n': put("\\n"); break;
+            case '\r': put("\\r"); break;
+            case '\t': put("\\t"); break;
+            default:
+                if (c < 0x20) {
+                    char escaped[7];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    put(std::string_view(escaped, 6));
+                } else {
+                    put(char(c));
+                }
+            }
+            i++;
+            continue;
+        }
+
+        size_t length = utf8_sequence_length(text, i);
+        if (length != 0) {
+            put(text.substr(i, length));
+            i += length;
+        } else {
+            put("\\ufffd");
+            i++;
+        }
+    }
+    put('"');
+}
+
+void TimerJsonWriter::putInt(int64_t value) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    put(std::string_view(digits, size_t(result.ptr - digits)));
+}
+
+void TimerJsonWriter::putFloat(double value) {
+    if (!std::isfinite(value)) {
+        put("null");
+        return;
+    }
+    char digits[32];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    std::string_view text(digits, size_t(result.ptr - digits));
+    put(text);
+    // Keeps the value a float when read back, like nlohmann writes 1.0
+    if (text.find_first_of(".e") == std::string_view::npos) put(".0");
+}
+
+void TimerJsonWriter::flush() {
+    file.write(buffer);
+    buffer.clear();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "TimerWise.h"
+
+// Streams a timers.json array into an AtomicFile through a fixed buffer,
+// without building nlohmann::json values. Pretty output has the layout and
+// key order of dump(4). Floats are written as the shortest text that reads
+// back to the same value, which can differ from nlohmann in the last digit.
+struct TimerJsonWriter {
+    static constexpr size_t BufferSize = 64 * 1024;
+
+    TimerJsonWriter(AtomicFile& file, JsonStyle style);
+
+    void write(std::string_view name, std::chrono::seconds duration, std::chrono::seconds timePassed,
+               const Color& color, WeekDays days, Period period);
+    void write(const Timer& timer);
+    // Closes the array and writes out the buffer, false if any write failed
+    bool finish();
+
+private:
+    void put(std::string_view text);
+    void put(char c);
+    void newline(int indent);
+    void key(std::string_view name, int indent);
+    void putString(std::string_view text);
+    void putInt(int64_t value);
+    void putFloat(double value);
+    void flush();
+
+    AtomicFile& file;
+    JsonStyle style;
+    std::string buffer;
+    size_t count = 0;
+};
@@ -0,0 +1,79 @@
+#include "Snapshot.h"
+
+#include "BinarySnapshot.h"
+
+Snapshot Snapshot::capture(const TimerStore& timers) {
+    Snapshot snapshot;
+    snapshot.timers.reserve(timers.count());
+    for (size_t ind = 0; ind < timers.size(); ind++) {
+        if (!timers.isAlive(ind)) continue;
+        snapshot.timers.push_back(timers.get(ind));
+    }
+    snapshot.date = format_date();
+    return snapshot;
+}
+
+bool write_snapshot(const Snapshot& snapshot, const std::filesystem::path& timersPath,
+                    const std::filesystem::path& binPath, const std::filesystem::path& datePath,
+                    TimerEncoding encoding) {
+    bool saved = snapshot.writeJson && save_timer_vec(snapshot.timers, timersPath, encoding);
+    if (save_timer_bin(snapshot.timers, binPath)) {
+        saved = true;
+    } else if (!snapshot.writeJson) {
+        // Newer than the stale timers.bin, so startup picks it instead
+        saved = save_timer_vec(snapshot.timers, timersPath, encoding);
+    }
+    return saved && save_date(snapshot.date, datePath);
+}
+
+SnapshotWriter::SnapshotWriter(std::filesystem::path timersPath, std::filesystem::path binPath,
+                               std::filesystem::path datePath)
+    : timersPath(std::move(timersPath)), binPath(std::move(binPath)), datePath(std::move(datePath)),
+      thread([this] { run(); }) {}
+
+SnapshotWriter::~SnapshotWriter() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+void SnapshotWriter::submit(Snapshot snapshot, Done done) {
+    {
+        std::lock_guard lock(mutex);
+        pending.emplace(std::move(snapshot), std::move(done));
+    }
+    wake.notify_one();
+}
+
+bool SnapshotWriter::busy() {
+    std::lock_guard lock(mutex);
+    return writing || pending;
+}
+
+void SnapshotWriter::flush() {
+    std::unique_lock lock(mutex);
+    idle.wait(lock, [this] { return !writing && !pending; });
+}
+
+void SnapshotWriter::run() {
+    std::unique_lock lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || pending; });
+        // Whatever is still queued gets written before the thread exits
+        if (!pending) break;
+
+        auto [snapshot, done] = std::move(*pending);
+        pending.reset();
+        writing = true;
+        lock.unlock();
+
+        if (write_snapshot(snapshot, timersPath, binPath, datePath, encoding) && done) done();
+
+        lock.lock();
+        writing = false;
+        if (!pending) idle.notify_all();
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TimerWise.h"
+
+// Everything a save writes, copied out of the store so the writer thread
+// never touches it
+struct Snapshot {
+    std::vector<Timer> timers;
+    std::string date;
+    // Startup reads timers.bin, so checkpoints leave timers.json alone.
+    // Set on exit so timers.json is current for other tools and older versions.
+    bool writeJson = false;
+
+    static Snapshot capture(const TimerStore& timers);
+};
+
+// Every file is replaced atomically. timers.json is only written when asked
+// for, or in place of a timers.bin that couldn't be written, and always before
+// timers.bin so the binary copy is never older than it. False when neither
+// holds the timers or days.txt failed.
+bool write_snapshot(const Snapshot& snapshot, const std::filesystem::path& timersPath,
+                    const std::filesystem::path& binPath, const std::filesystem::path& datePath,
+                    TimerEncoding encoding = TimerEncoding::Json);
+
+// Serializes and writes snapshots on a background thread so the frame loop
+// never waits for the disk. Only the newest submitted snapshot matters: one
+// that is still queued when another arrives is dropped.
+struct SnapshotWriter {
+    using Done = std::function<void()>;
+
+    SnapshotWriter(std::filesystem::path timersPath, std::filesystem::path binPath, std::filesystem::path datePath);
+    ~SnapshotWriter();
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    // Of timersPath, only set it before the first submit()
+    TimerEncoding encoding = TimerEncoding::Json;
+
+    // done runs on the writer thread once the snapshot is safely on disk
+    void submit(Snapshot snapshot, Done done = {});
+    bool busy();
+    // Blocks until everything submitted so far is written
+    void flush();
+
+private:
+    void run();
+
+    std::filesystem::path timersPath;
+    std::filesystem::path binPath;
+    std::filesystem::path datePath;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::optional<std::pair<Snapshot, Done>> pending;
+    bool writing = false;
+    bool stopping = false;
+    std::thread thread;
+};
@@ -0,0 +1,401 @@
+#include "TimerWise.h"
+#include "JsonWriter.h"
+
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <unistd.h>
+#endif
+
+TimerHandle get_timer_from_name(const TimerStore& timers, std::string_view name) {
+    return timers.find(name);
+}
+
+size_t utf8_sequence_length(std::string_view text, size_t pos) {
+    auto c = uint8_t(text[pos]);
+    if (c < 0x80) return 1;
+    size_t length = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : 2;
+    // Lowest and highest second byte allowed after this lead byte
+    uint8_t low = c == 0xE0 ? 0xA0 : c == 0xF0 ? 0x90 : 0x80;
+    uint8_t high = c == 0xED ? 0x9F : c == 0xF4 ? 0x8F : 0xBF;
+    if (c < 0xC2 || c > 0xF4 || pos + length > text.size()) return 0;
+    for (size_t k = 1; k < length; k++) {
+        auto next = uint8_t(text[pos + k]);
+        bool valid = k == 1 ? (next >= low && next <= high) : (next >= 0x80 && next <= 0xBF);
+        if (!valid) return 0;
+    }
+    return length;
+}
+
+bool make_valid_utf8(std::string& text) {
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t length = utf8_sequence_length(text, pos);
+        if (length == 0) break;
+        pos += length;
+    }
+    if (pos == text.size()) return false;
+
+    std::string fixed(text, 0, pos);
+    while (pos < text.size()) {
+        size_t length = utf8_sequence_length(text, pos);
+        if (length == 0) {
+            fixed += "\xEF\xBF\xBD";
+            pos++;
+        } else {
+            fixed.append(text, pos, length);
+            pos += length;
+        }
+    }
+    text.swap(fixed);
+    return true;
+}
+
+void reset_timer_vec(TimerStore& timers, const CalendarDate& date) {
+    Rollover rollover = Timer::update_calendar(date);
+    if (!rollover.day) return;
+    for (size_t ind = 0; ind < timers.size(); ind++) {
+        if (!period_rolled_over(timers.type[ind], rollover)) continue;
+        timers.resetElapsed(ind);
+    }
+}
+
+// Fills one reused Timer from SAX events and adds it to the store when its
+// object closes, so no DOM is built and nothing but that record is buffered
+struct TimerSaxHandler : nlohmann::json_sax<nlohmann::json> {
+    enum class Field { None, Name, Duration, TimePassed, Color, Days, Type, Interval, Unknown };
+    enum Seen : uint8_t { SeenName = 1, SeenDuration = 2, SeenTimePassed = 4, SeenColor = 8, SeenDays = 16, SeenType = 32 };
+    static constexpr uint8_t Required = SeenName | SeenDuration | SeenTimePassed | SeenColor | SeenDays | SeenType;
+
+    TimerStore& timers;
+    std::istream& in;
+    LoadError& error;
+    Timer timer{"", {}, Color{}, 0, {}};
+    Field field = Field::None;
+    uint8_t seen = 0;
+    int depth = 0;
+    // Nesting inside a value of an unknown key, skipped whole
+    int skipDepth = 0;
+    size_t colorInd = 0;
+    // Where the parser started in the file, past a CBOR tag. Its positions count from there.
+    size_t start = 0;
+
+    TimerSaxHandler(TimerStore& timers, std::istream& in, LoadError& error) : timers(timers), in(in), error(error) {}
+
+    bool fail(std::string message) {
+        auto pos = in.rdbuf()->pubseekoff(0, std::ios::cur, std::ios::in);
+        error.offset = pos < 0 ? 0 : size_t(pos);
+        error.message = std::move(message);
+        return false;
+    }
+
+    bool number(double value) {
+        if (skipDepth != 0 || field == Field::Unknown) return true;
+        if (depth == 3 && field == Field::Color) {
+            if (colorInd >= 3) return fail("color has more than 3 components");
+            float* channels[3] = {&timer.timerColor.r, &timer.timerColor.g, &timer.timerColor.b};
+            *channels[colorInd++] = float(value);
+            return true;
+        }
+        if (depth != 2) return fail("unexpected number");
+        switch (field) {
+        case Field::Duration:
+            timer.duration = std::chrono::seconds(int64_t(value));
+            seen |= SeenDuration;
+            return true;
+        case Field::TimePassed:
+            timer.timePassed = std::chrono::seconds(int64_t(value));
+            seen |= SeenTimePassed;
+            return true;
+        case Field::Interval:
+            timer.type.interval = uint16_t(std::clamp<double>(value, 1, UINT16_MAX));
+            return true;
+        default:
+            return fail("unexpected number");
+        }
+    }
+
+    bool null() override { return skipDepth != 0 || field == Field::Unknown || fail("unexpected null"); }
+    bool boolean(bool) override { return skipDepth != 0 || field == Field::Unknown || fail("unexpected boolean"); }
+    bool number_integer(number_integer_t value) override { return number(double(value)); }
+    bool number_unsigned(number_unsigned_t value) override { return number(double(value)); }
+    bool number_float(number_float_t value, const string_t&) override { return number(value); }
+    bool binary(binary_t&) override { return skipDepth != 0 || field == Field::Unknown || fail("unexpected binary value"); }
+
+    bool string(string_t& value) override {
+        if (skipDepth != 0 || field == Field::Unknown) return true;
+        if (depth == 3 && field == Field::Days) {
+            for (int wday = 0; wday < 7; wday++) {
+                if (value == DaysOfWeek[wday]) timer.days |= weekday_bit(wday);
+            }
+            return true;
+        }
+        if (depth != 2) return fail("unexpected string");
+        if (field == Field::Name) {
+            timer.name.swap(value);
+            seen |= SeenName;
+            return true;
+        }
+        if (field == Field::Type) {
+            for (int ind = 0; ind < 4; ind++) {
+                if (value == PeriodTypeNames[ind]) timer.type.type = PeriodType(ind);
+            }
+            seen |= SeenType;
+            return true;
+        }
+        return fail("unexpected string");
+    }
+
+    bool start_object(size_t) override {
+        if (skipDepth != 0 || field == Field::Unknown) {
+            skipDepth++;
+            return true;
+        }
+        if (depth != 1) return fail("expected a timer object");
+        depth = 2;
+        seen = 0;
+        field = Field::None;
+        timer.days = 0;
+        timer.type = Period{};
+        return true;
+    }
+
+    bool key(string_t& name) override {
+        if (skipDepth != 0) return true;
+        static constexpr std::pair<std::string_view, Field> Keys[] = {
+            {"name", Field::Name}, {"duration", Field::Duration}, {"timePassed", Field::TimePassed},
+            {"color", Field::Color}, {"days", Field::Days}, {"type", Field::Type}, {"interval", Field::Interval}};
+        field = Field::Unknown;
+        for (auto& [keyName, keyField] : Keys) {
+            if (name == keyName) field = keyField;
+        }
+        return true;
+    }
+
+    bool end_object() override {
+        if (skipDepth != 0) {
+            if (--skipDepth == 0) field = Field::None;
+            return true;
+        }
+        if ((seen & Required) != Required) return fail("timer is missing a required field");
+        if (timer.type.type != PeriodType::EveryNDays) timer.type.interval = 1;
+        make_valid_utf8(timer.name);
+        if (timers.find(timer.name) != NullTimer) {
+            timer.name = timers.uniqueName(timer.name);
+            error.renamed++;
+        }
+        timers.push_back(timer);
+        depth = 1;
+        field = Field::None;
+        return true;
+    }
+
+    bool start_array(size_t) override {
+        if (skipDepth != 0 || field == Field::Unknown) {
+            skipDepth++;
+            return true;
+        }
+        if (depth == 0) {
+            depth = 1;
+            return true;
+        }
+        if (depth == 2 && (field == Field::Color || field == Field::Days)) {
+            depth = 3;
+            colorInd = 0;
+            return true;
+        }
+        return fail("unexpected array");
+    }
+
+    bool end_array() override {
+        if (skipDepth != 0) {
+            if (--skipDepth == 0) field = Field::None;
+            return true;
+        }
+        if (depth == 3) {
+            if (field == Field::Color) {
+                if (colorInd != 3) return fail("color needs 3 components");
+                seen |= SeenColor;
+            } else {
+                seen |= SeenDays;
+            }
+            depth = 2;
+            field = Field::None;
+            return true;
+        }
+        depth = 0;
+        return true;
+    }
+
+    bool parse_error(size_t position, const std::string&, const nlohmann::detail::exception& ex) override {
+        error.offset = start + position;
+        error.message = ex.what();
+        return false;
+    }
+};
+
+// Tag 55799, marks the data as CBOR without changing its meaning
+constexpr char CborMagic[3] = {char(0xd9), char(0xd9), char(0xf7)};
+
+TimerEncoding detect_encoding(std::istream& in) {
+    char start[3] = {};
+    in.read(start, 3);
+    size_t read = size_t(in.gcount());
+    in.clear();
+    if (read == 3 && std::equal(start, start + 3, CborMagic)) return TimerEncoding::Cbor;
+    in.seekg(0);
+    if (read >= 2 && start[0] == '[' && start[1] == '#') return TimerEncoding::Ubjson;
+    auto first = uint8_t(start[0]);
+    if (read >= 1 && ((first >= 0x90 && first <= 0x9f) || first == 0xdc || first == 0xdd)) return TimerEncoding::MessagePack;
+    return TimerEncoding::Json;
+}
+
+bool load_timer_vec(TimerStore& timers, const std::filesystem::path &path, LoadError* error) {
+    std::ifstream f(path, std::ifstream::binary);
+    if (!f.is_open()) return true;
+    // Freshly created file
+    if (f.peek() == std::ifstream::traits_type::eof()) return true;
+
+    LoadError ignored;
+    TimerSaxHandler handler(timers, f, error ? *error : ignored);
+    TimerEncoding encoding = detect_encoding(f);
+    auto start = f.tellg();
+    handler.start = start < 0 ? 0 : size_t(start);
+    switch (encoding) {
+    case TimerEncoding::Cbor: return nlohmann::json::sax_parse(f, &handler, nlohmann::json::input_format_t::cbor);
+    case TimerEncoding::MessagePack: return nlohmann::json::sax_parse(f, &handler, nlohmann::json::input_format_t::msgpack);
+    case TimerEncoding::Ubjson: return nlohmann::json::sax_parse(f, &handler, nlohmann::json::input_format_t::ubjson);
+    default: return nlohmann::json::sax_parse(f, &handler);
+    }
+}
+
+bool save_timer_vec(const TimerStore& timers, const std::filesystem::path &path, JsonStyle style) {
+    AtomicFile file(path);
+    TimerJsonWriter writer(file, style);
+    for (size_t ind = 0; ind < timers.size(); ind++) {
+        if (!timers.isAlive(ind)) continue;
+        auto& meta = timers.meta[ind];
+        writer.write(meta.name, timers.duration[ind],
+                     std::chrono::duration_cast<std::chrono::seconds>(timers.elapsed(ind)),
+                     meta.timerColor, timers.days[ind], timers.type[ind]);
+    }
+    return writer.finish() && file.commit();
+}
+
+bool save_timer_vec(const std::vector<Timer>& timers, const std::filesystem::path &path, JsonStyle style) {
+    AtomicFile file(path);
+    TimerJsonWriter writer(file, style);
+    for (auto& timer : timers) writer.write(timer);
+    return writer.finish() && file.commit();
+}
+
+bool save_timer_vec(const std::vector<Timer>& timers, const std::filesystem::path &path, TimerEncoding encoding) {
+    if (encoding == TimerEncoding::Json) return save_timer_vec(timers, path);
+    nlohmann::json json = nlohmann::json::array();
+    for (auto& timer : timers) json.push_back(timer.to_json());
+
+    std::string out;
+    switch (encoding) {
+    case TimerEncoding::Cbor:
+        out.assign(CborMagic, sizeof(CborMagic));
+        nlohmann::json::to_cbor(json, out);
+        break;
+    case TimerEncoding::MessagePack:
+        nlohmann::json::to_msgpack(json, out);
+        break;
+    default:
+        // Counted, so the file starts with "[#" and can't be mistaken for JSON
+        nlohmann::json::to_ubjson(json, out, true);
+        break;
+    }
+    return atomic_write_file(path, out);
+}
+
+void load_date(const std::filesystem::path &path) {
+    std::ifstream f(path);
+    if (!f.is_open()) return;
+    // Older files only have day and week
+    f >> Timer::cur_day >> Timer::cur_week >> Timer::cur_month >> Timer::cur_epoch_day;
+}
+
+bool save_date(const std::string& date, const std::filesystem::path &path) {
+    return atomic_write_file(path, date);
+}
+
+std::string format_date() {
+    return std::to_string(Timer::cur_day) + " " + std::to_string(Timer::cur_week) + " " +
+        std::to_string(Timer::cur_month) + " " + std::to_string(Timer::cur_epoch_day);
+}
+
+AtomicFile::AtomicFile(const std::filesystem::path &target) : path(target), tmpPath(target) {
+    tmpPath += ".tmp";
+#ifdef _WIN32
+    fd = _wopen(tmpPath.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+    ok = fd >= 0;
+}
+
+AtomicFile::~AtomicFile() {
+    if (fd < 0) return;
+    // Never committed, the target keeps its old contents
+#ifdef _WIN32
+    _close(fd);
+#else
+    ::close(fd);
+#endif
+    std::error_code error;
+    std::filesystem::remove(tmpPath, error);
+}
+
+bool AtomicFile::write(std::string_view data) {
+    while (ok && !data.empty()) {
+#ifdef _WIN32
+        int n = _write(fd, data.data(), unsigned(std::min<size_t>(data.size(), INT_MAX)));
+#else
+        ssize_t n = ::write(fd, data.data(), data.size());
+        if (n < 0 && errno == EINTR) continue;
+#endif
+        ok = n > 0;
+        if (ok) data.remove_prefix(size_t(n));
+    }
+    return ok;
+}
+
+bool AtomicFile::commit() {
+    if (fd < 0) return false;
+#ifdef _WIN32
+    ok = ok && _commit(fd) == 0;
+    ok = _close(fd) == 0 && ok;
+#else
+    ok = ok && ::fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+#endif
+    fd = -1;
+    std::error_code error;
+    if (ok) std::filesystem::rename(tmpPath, path, error);
+    if (!ok || error) {
+        std::filesystem::remove(tmpPath, error);
+        return ok = false;
+    }
+#ifndef _WIN32
+    // The rename itself only survives a power cut once the directory is synced
+    int dir = ::open(path.has_parent_path() ? path.parent_path().c_str() : ".", O_RDONLY);
+    if (dir >= 0) {
+        ::fsync(dir);
+        ::close(dir);
+    }
+#endif
+    return true;
+}
+
+bool atomic_write_file(const std::filesystem::path &path, std::string_view contents) {
+    AtomicFile file(path);
+    file.write(contents);
+    return file.commit();
+}
@@ -4,11 +4,18 @@
 #include <algorithm>
 #include <array>
 #include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <ctime>
+#include <filesystem>
 #include <nlohmann/json.hpp>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
+#include "TimingWheel.h"
+
 struct Color {
 public:
   float r;
@@ -26,45 +33,256 @@ public:
 
 constexpr const char* DaysOfWeek[7] = {"Sunday",   "Monday", "Tuesday", "Wednesday",
                                    "Thursday", "Friday", "Saturday"};
+constexpr const char* DaysOfWeekShort[7] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+
+// Bit n is set when the timer is available on DaysOfWeek[n] (tm_wday order)
+using WeekDays = uint8_t;
+constexpr WeekDays AllWeekDays = 0x7F;
+
+constexpr WeekDays weekday_bit(int wday) { return WeekDays(1u << wday); }
+
+inline WeekDays weekdays_from_json(const nlohmann::json &j) {
+    WeekDays mask = 0;
+    for (auto &day : j) {
+        auto &name = day.get_ref<const std::string &>();
+        for (int wday = 0; wday < 7; wday++) {
+            if (name == DaysOfWeek[wday]) mask |= weekday_bit(wday);
+        }
+    }
+    return mask;
+}
+
+inline nlohmann::json weekdays_to_json(WeekDays mask) {
+    auto j = nlohmann::json::array();
+    for (int wday = 0; wday < 7; wday++) {
+        if (mask & weekday_bit(wday)) j.push_back(DaysOfWeek[wday]);
+    }
+    return j;
+}
+
+enum class PeriodType : uint8_t { Daily, Weekly, Monthly, EveryNDays };
+constexpr const char* PeriodTypeNames[4] = {"daily", "weekly", "monthly", "every_n_days"};
+
+// How often timePassed goes back to zero. interval is only used by EveryNDays.
+struct Period {
+    PeriodType type = PeriodType::Daily;
+    uint16_t interval = 1;
+
+    bool operator==(const Period&) const = default;
+};
+
+// Calendar boundaries crossed since the previous check
+struct Rollover {
+    bool day;
+    bool week;
+    bool month;
+    int prevEpochDay;
+    int epochDay;
+};
+
+constexpr bool period_rolled_over(Period period, const Rollover& rollover) {
+    switch (period.type) {
+    case PeriodType::Daily: return rollover.day;
+    case PeriodType::Weekly: return rollover.week;
+    case PeriodType::Monthly: return rollover.month;
+    case PeriodType::EveryNDays:
+        return rollover.prevEpochDay / period.interval != rollover.epochDay / period.interval;
+    }
+    return false;
+}
+
+inline Period period_from_json(const nlohmann::json &j) {
+    Period period{};
+    auto &name = j.at("type").get_ref<const std::string &>();
+    for (int ind = 0; ind < 4; ind++) {
+        if (name == PeriodTypeNames[ind]) period.type = PeriodType(ind);
+    }
+    if (period.type == PeriodType::EveryNDays) {
+        period.interval = std::max(1, j.value("interval", 1));
+    }
+    return period;
+}
+
+inline void period_to_json(Period period, nlohmann::json &j) {
+    j["type"] = PeriodTypeNames[int(period.type)];
+    if (period.type == PeriodType::EveryNDays) j["interval"] = period.interval;
+}
+
+// Local calendar fields of one wall clock sample
+struct CalendarDate {
+    int yday;
+    int wday;
+    // Monday based week of the year
+    int week;
+    // year * 12 + month
+    int month;
+    // Days since 1970-01-01
+    int epochDay;
+
+    static tm local_datetime(time_t time) {
+        tm datetime{};
+#ifdef _WIN32
+        localtime_s(&datetime, &time);
+#else
+        localtime_r(&time, &datetime);
+#endif
+        return datetime;
+    }
+
+    static CalendarDate from(time_t time) {
+        tm datetime = local_datetime(time);
+        auto ymd = std::chrono::year{datetime.tm_year + 1900} /
+                   std::chrono::month(datetime.tm_mon + 1) /
+                   std::chrono::day(datetime.tm_mday);
+        CalendarDate date{};
+        date.yday = datetime.tm_yday;
+        date.wday = datetime.tm_wday;
+        date.week = (datetime.tm_yday + 7 - (datetime.tm_wday ? (datetime.tm_wday - 1) : 6)) / 7;
+        date.month = (datetime.tm_year + 1900) * 12 + datetime.tm_mon;
+        date.epochDay = std::chrono::sys_days{ymd}.time_since_epoch().count();
+        return date;
+    }
+
+    // Local midnight starting the day `days` after the one containing `time`
+    static time_t midnight(time_t time, int days = 0) {
+        tm datetime = local_datetime(time);
+        datetime.tm_mday += days;
+        datetime.tm_hour = 0;
+        datetime.tm_min = 0;
+        datetime.tm_sec = 0;
+        datetime.tm_isdst = -1;
+        return mktime(&datetime);
+    }
+};
+
+// Where Clock::tick() takes the time from
+struct ClockSource {
+    virtual ~ClockSource() = default;
+    virtual std::chrono::steady_clock::time_point steadyNow() = 0;
+    virtual time_t wallNow() = 0;
+};
+
+struct SystemClock : ClockSource {
+    std::chrono::steady_clock::time_point steadyNow() override { return std::chrono::steady_clock::now(); }
+    time_t wallNow() override { return time(0); }
+};
+
+// Only moves when advance() is called, so weeks of rollovers and expiries can
+// be simulated in a few milliseconds. Wall time follows steady time from the
+// starting point.
+struct VirtualClock : ClockSource {
+    std::chrono::steady_clock::time_point steadyStart;
+    std::chrono::steady_clock::time_point steady;
+    time_t wallStart;
+
+    VirtualClock(time_t wall = time(0), std::chrono::steady_clock::time_point start = {})
+        : steadyStart(start), steady(start), wallStart(wall) {}
+
+    std::chrono::steady_clock::time_point steadyNow() override { return steady; }
+
+    time_t wallNow() override {
+        return wallStart + time_t(std::chrono::duration_cast<std::chrono::seconds>(steady - steadyStart).count());
+    }
+
+    void advance(std::chrono::steady_clock::duration by) { steady += by; }
+};
+
+// Clocks are sampled once per loop iteration by tick(), everything else reads
+// the cached values so a frame sees one consistent time.
+struct Clock {
+    static inline SystemClock systemClock{};
+    static inline ClockSource* source = &systemClock;
+
+    static inline std::chrono::steady_clock::time_point now{};
+    static inline time_t wallNow{};
+    static inline CalendarDate date{};
+    // date is only recomputed outside of [dayStart, dayEnd)
+    static inline time_t dayStart{0};
+    static inline time_t dayEnd{0};
+
+    // Swaps the time source, the calendar is recomputed on the next tick
+    static void use(ClockSource& newSource) {
+        source = &newSource;
+        dayStart = 0;
+        dayEnd = 0;
+    }
+
+    static void tick() {
+        now = source->steadyNow();
+        wallNow = source->wallNow();
+        if (wallNow >= dayEnd || wallNow < dayStart) {
+            date = CalendarDate::from(wallNow);
+            dayStart = CalendarDate::midnight(wallNow);
+            dayEnd = CalendarDate::midnight(wallNow, 1);
+        }
+    }
+};
+
+// Decides when reset_timer_vec has anything to do. Week, month and every N days
+// boundaries all fall on a local midnight, so one deadline covers every period.
+// A deadline missed while suspended fires on the first check after waking up.
+struct RolloverScheduler {
+    time_t nextDay = 0;
+
+    bool due(time_t now) const { return now >= nextDay; }
+
+    void schedule(time_t now) { nextDay = CalendarDate::midnight(now, 1); }
+};
+
+// Coalesces a burst of changes into one save per interval. The first change
+// after a save starts the countdown, so at most one interval of changes is
+// ever only in memory, however often the store is marked.
+struct AutosavePolicy {
+    std::chrono::steady_clock::duration interval = std::chrono::seconds(30);
+    std::chrono::steady_clock::time_point dirtySince{};
+    bool dirty = false;
+
+    void markDirty(std::chrono::steady_clock::time_point now) {
+        if (dirty) return;
+        dirty = true;
+        dirtySince = now;
+    }
+
+    bool due(std::chrono::steady_clock::time_point now) const { return dirty && now - dirtySince >= interval; }
+
+    void saved() { dirty = false; }
+};
 
 struct Timer {
   std::chrono::seconds duration;
   std::chrono::milliseconds timePassed;
-
-  std::chrono::steady_clock::time_point lastChecked;
   
   Timer(const nlohmann::json &j) {
     j.at("name").get_to(name);
-    auto colorsJson = j.at("color");
+    auto& colorsJson = j.at("color");
     timerColor = Color{colorsJson[0], colorsJson[1], colorsJson[2]};
     duration = std::chrono::seconds(j.at("duration"));
     timePassed = std::chrono::seconds(j.at("timePassed"));
-    j.at("days").get_to(days);
-    j.at("type").get_to(type);
+    days = weekdays_from_json(j.at("days"));
+    type = period_from_json(j);
   }
 
   // TODO: Figure out how to change the order of attributes
   nlohmann::json to_json() const {
-    return nlohmann::json{
+    nlohmann::json j{
         {"name", name},
         {"duration", duration.count()},
         {"timePassed",
          std::chrono::duration_cast<std::chrono::seconds>(timePassed).count()},
-        {"type", type},
         {"color",
          nlohmann::json::array({timerColor.r, timerColor.g, timerColor.b})},
-        {"days", days}};
+        {"days", weekdays_to_json(days)}};
+    period_to_json(type, j);
+    return j;
   }
 
     std::string name;
     Color timerColor;
-    std::string type;
-    std::vector<std::string> days;
+    Period type;
+    WeekDays days;
 
-    Timer(std::string name, std::chrono::seconds dur, Color c,std::vector<std::string> days, std::string typ) 
-        : name(name), timePassed(std::chrono::milliseconds(0)), duration(dur), type(typ), days(days), timerColor(c) {
-        lastChecked = std::chrono::steady_clock::now();
-    }
+    Timer(std::string name, std::chrono::seconds dur, Color c, WeekDays days, Period typ) 
+        : name(name), timePassed(std::chrono::milliseconds(0)), duration(dur), type(typ), days(days), timerColor(c) {}
 
     float getDuration() const { return duration.count(); }
 
@@ -77,38 +295,31 @@ struct Timer {
     }
 
   std::string getFormattedTimePassed() const {
-    std::string out{};
-    auto timePassedSecs =
-        std::chrono::duration_cast<std::chrono::seconds>(timePassed);
-    auto hours = std::chrono::duration_cast<std::chrono::hours>(duration - timePassedSecs);
-
-    if (hours.count() > 0) {
-      auto minutes = std::chrono::duration_cast<std::chrono::minutes>(duration - timePassedSecs - std::chrono::duration_cast<std::chrono::minutes>(hours));
-      auto minutesStr = std::to_string(minutes.count());
-      auto hoursStr = std::to_string(hours.count());
-      if (minutesStr.length() < 2) {
-        minutesStr = "0" + minutesStr;
-      }
-      if (hoursStr.length() < 2) {
-        out = "0" + hoursStr + ":" + minutesStr;
-      } else {
-        out = hoursStr + ":" + minutesStr;
-      }
+    char buf[TimeLeftBufSize];
+    return std::string(buf, formatTimeLeft(buf, duration, timePassed));
+  }
+
+  static constexpr size_t TimeLeftBufSize = 24;
+
+  // Whole seconds left, the countdown only ever shows those
+  static int64_t secondsLeft(std::chrono::seconds duration, std::chrono::nanoseconds timePassed) {
+    auto left = duration - std::chrono::duration_cast<std::chrono::seconds>(timePassed);
+    return std::max<int64_t>(left.count(), 0);
+  }
+
+  // HH:MM when at least an hour is left, M:SS otherwise. Doesn't allocate.
+  static size_t formatTimeLeft(char (&out)[TimeLeftBufSize], int64_t left) {
+    int written;
+    if (left >= 3600) {
+      written = snprintf(out, TimeLeftBufSize, "%02lld:%02lld", (long long)(left / 3600), (long long)(left % 3600 / 60));
     } else {
-      auto minutes = std::chrono::duration_cast<std::chrono::minutes>(
-          duration - timePassedSecs);
-      auto seconds = std::chrono::duration_cast<std::chrono::seconds>(
-          duration - timePassedSecs -
-          std::chrono::duration_cast<std::chrono::seconds>(minutes));
-      auto secondsStr = std::to_string(seconds.count());
-      auto minutesStr = std::to_string(minutes.count());
-      if (secondsStr.length() < 2) {
-        out = minutesStr + ":" + "0" + secondsStr;
-      } else {
-        out = minutesStr + ":" + secondsStr;
-      }
-    }
-    return out;
+      written = snprintf(out, TimeLeftBufSize, "%lld:%02lld", (long long)(left / 60), (long long)(left % 60));
+    }
+    return std::min<size_t>(written, TimeLeftBufSize - 1);
+  }
+
+  static size_t formatTimeLeft(char (&out)[TimeLeftBufSize], std::chrono::seconds duration, std::chrono::nanoseconds timePassed) {
+    return formatTimeLeft(out, secondsLeft(duration, timePassed));
   }
 
   float getTimePassed() const {
@@ -117,66 +328,466 @@ struct Timer {
 
     static inline int cur_day{0};
     static inline int cur_week{0};
+    static inline int cur_month{0};
+    static inline int cur_epoch_day{0};
 
-    static tm get_datetime() {
-        time_t curtime = time(0);
-        tm datetime;
-        localtime_s(&datetime, &curtime);
-        return datetime;
-    }
-
-    static bool update_day() {
-        tm datetime = get_datetime();
-        int new_day = datetime.tm_yday;
-        bool did_day_change = new_day != cur_day;
-        cur_day = new_day;
+    static bool update_day(const CalendarDate& date) {
+        bool did_day_change = date.yday != cur_day;
+        cur_day = date.yday;
         return did_day_change;
     }
 
-    static bool update_week() {
-        tm datetime = get_datetime();
-        int new_week = (datetime.tm_yday + 7 -(datetime.tm_wday ? (datetime.tm_wday - 1) : 6)) /7;
-        bool did_week_change = new_week != cur_week;
-        cur_week = new_week;
+    static bool update_week(const CalendarDate& date) {
+        bool did_week_change = date.week != cur_week;
+        cur_week = date.week;
         return did_week_change;
     }
+
+    static bool update_month(const CalendarDate& date) {
+        bool did_month_change = date.month != cur_month;
+        cur_month = date.month;
+        return did_month_change;
+    }
+
+    static int update_epoch_day(const CalendarDate& date) {
+        int prev_epoch_day = cur_epoch_day;
+        cur_epoch_day = date.epochDay;
+        return prev_epoch_day;
+    }
+
+    static Rollover update_calendar(const CalendarDate& date = Clock::date) {
+        Rollover rollover{};
+        rollover.day = update_day(date);
+        rollover.week = update_week(date);
+        rollover.month = update_month(date);
+        rollover.prevEpochDay = update_epoch_day(date);
+        rollover.epochDay = cur_epoch_day;
+        return rollover;
+    }
+};
+
+struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view str) const { return std::hash<std::string_view>{}(str); }
+};
+
+// Stays valid while other timers are added or removed. A handle to a removed
+// timer never resolves again, even after its slot is reused.
+struct TimerHandle {
+    uint32_t slot = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool operator==(const TimerHandle&) const = default;
 };
 
-size_t get_timer_from_name(std::vector<Timer>& timers, const std::string name) {
-    for (auto ind = 0; ind < timers.size(); ind++) {
-      if (timers[ind].name == name)
-        return ind;
+constexpr TimerHandle NullTimer{};
+
+// Owns the only copy of every timer name, so lookups by string_view don't allocate
+using NameIndex = std::unordered_map<std::string, TimerHandle, StringHash, std::equal_to<>>;
+
+// Countdown text of one timer, rebuilt only when the shown value changes
+struct TimeLeftText {
+    char buf[Timer::TimeLeftBufSize];
+    uint8_t len = 0;
+    // Seconds left, or minutes left in the hour format. -1 when nothing was formatted yet.
+    int64_t shown = -1;
+
+    std::string_view update(std::chrono::seconds duration, std::chrono::nanoseconds timePassed) {
+        int64_t left = Timer::secondsLeft(duration, timePassed);
+        int64_t key = (left >= 3600) ? (left / 60) | (int64_t(1) << 62) : left;
+        if (key != shown) {
+            len = uint8_t(Timer::formatTimeLeft(buf, left));
+            shown = key;
+        }
+        return {buf, len};
     }
-    return -1;
-}
+};
+
+// Fields that are only touched on config, display of names and saving
+struct TimerMeta {
+    // Interned, points into the key of TimerStore::index
+    std::string_view name;
+    Color timerColor;
+};
+
+// Timers stored as struct of arrays. Per-frame passes only walk the hot arrays,
+// cold metadata is kept in a separate table indexed the same way.
+// Indices shift on compact, anything kept across frames should hold a TimerHandle.
+// Erased timers stay behind as dead rows until compact() so bulk removal is O(n).
+struct TimerStore {
+    static constexpr uint32_t DeadSlot = UINT32_MAX;
+    // indexOf() of a removed timer
+    static constexpr size_t NotFound = SIZE_MAX;
+    static constexpr auto NotRunning = std::chrono::steady_clock::time_point::max();
 
-void reset_timer_vec(std::vector<Timer>& timers) {
-    bool reset_daily = Timer::update_day();
-    bool reset_weekly = Timer::update_week();
-    for (auto &t : timers) {
-        if (!reset_daily && t.type == "daily") continue;
-        if (!reset_weekly && t.type == "weekly") continue;
-        t.timePassed = std::chrono::milliseconds(0);
+    struct Slot {
+        uint32_t ind;
+        uint32_t generation;
+    };
+    std::vector<std::chrono::seconds> duration;
+    // Elapsed time up to the last pause, running time since startedAt comes on top.
+    // Kept at clock precision so nothing is lost between pauses.
+    std::vector<std::chrono::steady_clock::duration> timePassed;
+    std::vector<std::chrono::steady_clock::time_point> startedAt;
+    // When a running timer completes, NotRunning otherwise
+    std::vector<std::chrono::steady_clock::time_point> finishAt;
+    std::vector<WeekDays> days;
+    std::vector<Period> type;
+    std::vector<TimeLeftText> timeLeftText;
+    std::vector<TimerMeta> meta;
+    // Owning slot of each timer, DeadSlot for erased rows
+    std::vector<uint32_t> slot;
+    size_t deadCount = 0;
+    size_t runningCount = 0;
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+    NameIndex index;
+
+    // Names in meta point into index, copying would leave them dangling
+    TimerStore() = default;
+    TimerStore(const TimerStore&) = delete;
+    TimerStore& operator=(const TimerStore&) = delete;
+    TimerStore(TimerStore&&) = default;
+    TimerStore& operator=(TimerStore&&) = default;
+
+    // Number of rows including dead ones, use for iteration
+    size_t size() const { return duration.size(); }
+    size_t count() const { return size() - deadCount; }
+    bool empty() const { return count() == 0; }
+    bool isAlive(size_t ind) const { return slot[ind] != DeadSlot; }
+    bool isRunning(size_t ind) const { return finishAt[ind] != NotRunning; }
+    // Filter of the "Timers for Today" list, day is a weekday_bit()
+    bool availableOn(size_t ind, WeekDays day) const { return (days[ind] & day) && isAlive(ind); }
+
+    void reserve(size_t n) {
+        duration.reserve(n);
+        timePassed.reserve(n);
+        startedAt.reserve(n);
+        finishAt.reserve(n);
+        days.reserve(n);
+        type.reserve(n);
+        timeLeftText.reserve(n);
+        meta.reserve(n);
+        slot.reserve(n);
+        slots.reserve(n);
+        index.reserve(n);
     }
-}
 
-void save_timer_vec(std::vector<Timer>& timers, const std::filesystem::path &path) {
-    std::ofstream f(path, std::ofstream::trunc);
-    if (!f.is_open()) return;
+    // NotFound when the timer was removed
+    size_t indexOf(TimerHandle handle) const {
+        if (handle.slot >= slots.size()) return NotFound;
+        auto& s = slots[handle.slot];
+        return (s.generation == handle.generation) ? size_t(s.ind) : NotFound;
+    }
 
-    std::vector<nlohmann::json> jsonVec{};
-    for (auto& timer : timers) {
-      jsonVec.push_back(timer.to_json());
+    TimerHandle handleAt(size_t ind) const {
+        return TimerHandle{slot[ind], slots[slot[ind]].generation};
     }
-    nlohmann::json json(jsonVec);
-    f << json.dump(4);
-    f.close();
-}
 
-void save_date(std::string& date, const std::filesystem::path &path) {
-    std::fstream f(path);
-    if (!f.is_open()) return;
-    f << date;
-    f.close();
+    TimerHandle find(std::string_view name) const {
+        auto it = index.find(name);
+        return (it == index.end()) ? NullTimer : it->second;
+    }
 
-}
+    // name itself when it's free, otherwise the first free "name (2)", "name (3)", ...
+    std::string uniqueName(std::string_view name) const {
+        std::string candidate(name);
+        for (int n = 2; index.contains(candidate); n++) {
+            candidate.assign(name);
+            candidate += " (" + std::to_string(n) + ")";
+        }
+        return candidate;
+    }
+
+    // Names are unique, returns NullTimer when the name is already taken
+    TimerHandle push_back(const Timer& timer) {
+        auto [it, inserted] = index.try_emplace(timer.name);
+        if (!inserted) return NullTimer;
+
+        uint32_t s;
+        if (freeSlots.empty()) {
+            s = uint32_t(slots.size());
+            slots.push_back(Slot{0, 0});
+        } else {
+            s = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        slots[s].ind = uint32_t(size());
+        it->second = TimerHandle{s, slots[s].generation};
+
+        duration.push_back(timer.duration);
+        timePassed.push_back(timer.timePassed);
+        startedAt.emplace_back();
+        finishAt.push_back(NotRunning);
+        days.push_back(timer.days);
+        type.push_back(timer.type);
+        timeLeftText.emplace_back();
+        meta.push_back(TimerMeta{it->first, timer.timerColor});
+        slot.push_back(s);
+        return it->second;
+    }
+
+    bool rename(size_t ind, std::string_view name) {
+        if (meta[ind].name == name) return true;
+        if (index.contains(name)) return false;
+        auto node = index.extract(index.find(meta[ind].name));
+        node.key() = name;
+        meta[ind].name = index.insert(std::move(node)).position->first;
+        return true;
+    }
+
+    // Replaces everything except elapsed time, false when the new name is taken
+    bool set(size_t ind, const Timer& timer) {
+        if (!rename(ind, timer.name)) return false;
+        duration[ind] = timer.duration;
+        days[ind] = timer.days;
+        type[ind] = timer.type;
+        meta[ind].timerColor = timer.timerColor;
+        return true;
+    }
+
+    Timer get(size_t ind) const {
+        auto& m = meta[ind];
+        Timer timer{std::string(m.name), duration[ind], m.timerColor, days[ind], type[ind]};
+        timer.timePassed = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed(ind));
+        return timer;
+    }
+
+    // Only marks the row as dead, the timer can't be found by name or handle anymore
+    bool erase(TimerHandle handle) {
+        size_t ind = indexOf(handle);
+        if (ind == NotFound) return false;
+
+        slots[handle.slot].generation++;
+        freeSlots.push_back(handle.slot);
+        index.erase(index.find(meta[ind].name));
+        meta[ind].name = {};
+        if (isRunning(ind)) runningCount--;
+        finishAt[ind] = NotRunning;
+        slot[ind] = DeadSlot;
+        deadCount++;
+        return true;
+    }
+
+    // Drops all dead rows in a single pass, keeps the order of live ones
+    void compact() {
+        if (deadCount == 0) return;
+        size_t out = 0;
+        for (size_t ind = 0; ind < size(); ind++) {
+            if (!isAlive(ind)) continue;
+            if (out != ind) {
+                duration[out] = duration[ind];
+                timePassed[out] = timePassed[ind];
+                startedAt[out] = startedAt[ind];
+                finishAt[out] = finishAt[ind];
+                days[out] = days[ind];
+                type[out] = type[ind];
+                timeLeftText[out] = timeLeftText[ind];
+                meta[out] = meta[ind];
+                slot[out] = slot[ind];
+                slots[slot[out]].ind = uint32_t(out);
+            }
+            out++;
+        }
+        duration.resize(out);
+        timePassed.resize(out);
+        startedAt.resize(out);
+        finishAt.resize(out);
+        days.resize(out);
+        type.resize(out);
+        timeLeftText.resize(out);
+        meta.resize(out);
+        slot.resize(out);
+        deadCount = 0;
+    }
+
+    // Compacts once a quarter of the rows are dead, or whenever there is spare time
+    bool compactIfNeeded(bool idle = false) {
+        if (deadCount == 0) return false;
+        if (!idle && deadCount * 4 < size()) return false;
+        compact();
+        return true;
+    }
+
+    void clear() {
+        duration.clear();
+        timePassed.clear();
+        startedAt.clear();
+        finishAt.clear();
+        runningCount = 0;
+        days.clear();
+        type.clear();
+        timeLeftText.clear();
+        meta.clear();
+        for (uint32_t s : slot) {
+            if (s == DeadSlot) continue;
+            slots[s].generation++;
+            freeSlots.push_back(s);
+        }
+        slot.clear();
+        deadCount = 0;
+        index.clear();
+    }
+
+    float getDuration(size_t ind) const { return duration[ind].count(); }
+
+    // Computed on read, running timers are never written to between start and pause
+    std::chrono::steady_clock::duration elapsed(size_t ind, std::chrono::steady_clock::time_point now = Clock::now) const {
+        if (!isRunning(ind)) return timePassed[ind];
+        return timePassed[ind] + (now - startedAt[ind]);
+    }
+
+    void resetElapsed(size_t ind, std::chrono::steady_clock::time_point now = Clock::now) {
+        timePassed[ind] = {};
+        startedAt[ind] = now;
+    }
+
+    float getTimePassed(size_t ind) const {
+        return std::chrono::duration_cast<std::chrono::seconds>(elapsed(ind)).count();
+    }
+
+    // Valid until the next call for the same timer
+    std::string_view getFormattedTimePassed(size_t ind) {
+        return timeLeftText[ind].update(duration[ind], elapsed(ind));
+    }
+};
+
+// Starts, pauses and completes timers. Completion is found through a timing
+// wheel of finish instants, so starting is O(1) and a frame where nothing
+// completes only looks at the slots for the milliseconds that passed.
+// Pausing doesn't touch the wheel, stale entries are dropped when they come out,
+// or all at once when they outnumber the running timers.
+struct RunningTimers {
+    TimingWheel<TimerHandle> wheel;
+    std::vector<TimingWheel<TimerHandle>::Entry> fired;
+    // Rows that finished in the last expire()
+    std::vector<size_t> finished;
+    // Rows that still have an entry, used by dropStale()
+    std::vector<bool> kept;
+
+    // Also used to push back the deadline of a running timer after an edit
+    void start(TimerStore& timers, size_t ind, std::chrono::steady_clock::time_point now) {
+        if (!timers.isRunning(ind)) {
+            timers.startedAt[ind] = now;
+            timers.runningCount++;
+        }
+        auto left = timers.duration[ind] - timers.timePassed[ind];
+        timers.finishAt[ind] = timers.startedAt[ind] + left;
+        wheel.insert(timers.handleAt(ind), timers.finishAt[ind], now);
+        if (wheel.size() > 2 * timers.runningCount + 64) dropStale(timers);
+    }
+
+    void pause(TimerStore& timers, size_t ind, std::chrono::steady_clock::time_point now) {
+        if (!timers.isRunning(ind)) return;
+        timers.timePassed[ind] += now - timers.startedAt[ind];
+        timers.finishAt[ind] = TimerStore::NotRunning;
+        timers.runningCount--;
+    }
+
+    // Stops every timer whose finish instant has passed, returns how many did
+    size_t expire(TimerStore& timers, std::chrono::steady_clock::time_point now) {
+        fired.clear();
+        finished.clear();
+        wheel.advance(now, fired);
+        size_t expired = 0;
+        for (auto& entry : fired) {
+            size_t ind = timers.indexOf(entry.value);
+            if (ind == TimerStore::NotFound || timers.finishAt[ind] != entry.at) continue;
+            pause(timers, ind, now);
+            finished.push_back(ind);
+            expired++;
+        }
+        return expired;
+    }
+
+    // Entries of timers that were paused, removed or moved since they were
+    // inserted. A pause and start at the same instant inserts the same finish
+    // instant again, only one of those is kept.
+    void dropStale(const TimerStore& timers) {
+        kept.assign(timers.size(), false);
+        wheel.removeIf([&](const TimingWheel<TimerHandle>::Entry& entry) {
+            size_t ind = timers.indexOf(entry.value);
+            if (ind == TimerStore::NotFound || timers.finishAt[ind] != entry.at || kept[ind]) return true;
+            kept[ind] = true;
+            return false;
+        });
+    }
+
+    // Finish instants move when elapsed time is reset, e.g. on rollover
+    void reschedule(TimerStore& timers, std::chrono::steady_clock::time_point now) {
+        wheel.clear();
+        for (size_t ind = 0; ind < timers.size(); ind++) {
+            if (!timers.isRunning(ind)) continue;
+            timers.finishAt[ind] = timers.startedAt[ind] + (timers.duration[ind] - timers.timePassed[ind]);
+            wheel.insert(timers.handleAt(ind), timers.finishAt[ind], now);
+        }
+    }
+};
+
+TimerHandle get_timer_from_name(const TimerStore& timers, std::string_view name);
+
+// Bytes in the well-formed UTF-8 sequence starting at text[pos], 0 when there is none
+size_t utf8_sequence_length(std::string_view text, size_t pos);
+// Replaces every byte that isn't part of well-formed UTF-8 with U+FFFD, the
+// way timers.json is written. The binary encodings and timers.bin don't check
+// names, so they are fixed on load. False when nothing had to change.
+bool make_valid_utf8(std::string& text);
+// Resets timers whose period ended between the saved calendar position and date
+void reset_timer_vec(TimerStore& timers, const CalendarDate& date = Clock::date);
+
+// Where and why a file couldn't be loaded
+struct LoadError {
+    // Counted from the start of the file in every encoding
+    size_t offset = 0;
+    std::string message;
+    // Timers whose name was already taken and got a suffix instead, files
+    // written before names had to be unique can have those
+    size_t renamed = 0;
+};
+
+// Encodings timers.json can be saved in. Loading tells them apart by the
+// first bytes: CBOR starts with the self-describe tag, UBJSON with a counted
+// array ("[#"), MessagePack with an array marker, anything else is JSON.
+enum class TimerEncoding : uint8_t { Json, Cbor, MessagePack, Ubjson };
+constexpr const char* TimerEncodingNames[4] = {"json", "cbor", "msgpack", "ubjson"};
+
+// Leaves the stream at the start of the document, past a CBOR tag
+TimerEncoding detect_encoding(std::istream& in);
+
+// Streams the file into the store without building a JSON document, in any
+// TimerEncoding. Names are made valid UTF-8, and a timer whose name is already
+// in the store is renamed with TimerStore::uniqueName().
+// On malformed input it stops and returns false, the timers read before the
+// error stay.
+bool load_timer_vec(TimerStore& timers, const std::filesystem::path &path, LoadError* error = nullptr);
+// Pretty is what older versions wrote, compact is about half the size
+enum class JsonStyle : uint8_t { Pretty, Compact };
+bool save_timer_vec(const TimerStore& timers, const std::filesystem::path &path, JsonStyle style = JsonStyle::Pretty);
+bool save_timer_vec(const std::vector<Timer>& timers, const std::filesystem::path &path, JsonStyle style = JsonStyle::Pretty);
+bool save_timer_vec(const std::vector<Timer>& timers, const std::filesystem::path &path, TimerEncoding encoding);
+
+// Reads the calendar position saved by save_date into Timer's statics
+void load_date(const std::filesystem::path &path);
+bool save_date(const std::string& date, const std::filesystem::path &path);
+// Timer's calendar statics in the days.txt layout
+std::string format_date();
+
+// Writes a temp file next to path, flushes it to disk and renames it over path
+// on commit(), so path always holds either the old or the new contents
+struct AtomicFile {
+    std::filesystem::path path;
+    std::filesystem::path tmpPath;
+    int fd = -1;
+    bool ok = false;
+
+    explicit AtomicFile(const std::filesystem::path &target);
+    ~AtomicFile();
+    AtomicFile(const AtomicFile&) = delete;
+    AtomicFile& operator=(const AtomicFile&) = delete;
+
+    bool write(std::string_view data);
+    bool commit();
+};
+
+bool atomic_write_file(const std::filesystem::path &path, std::string_view contents);
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Hierarchical timing wheel with millisecond, second, minute and hour levels.
+// Entries further away than the current day wait in an overflow list that is
+// re-sorted once per day. Inserting is O(1), and advancing costs one slot per
+// elapsed millisecond while something is due within the current second; empty
+// stretches are skipped a whole second, minute, hour or day at a time.
+// Cancelling doesn't remove anything: a cancelled entry stays in its slot and the
+// caller drops it when it comes out of advance(), or sweeps it with removeIf()
+// before too many pile up.
+template <class T>
+struct TimingWheel {
+    using time_point = std::chrono::steady_clock::time_point;
+
+    struct Entry {
+        T value;
+        time_point at;
+    };
+
+    static constexpr size_t LevelCount = 4;
+    static constexpr std::array<uint64_t, LevelCount> SlotTicks{1, 1000, 60'000, 3'600'000};
+    static constexpr std::array<uint64_t, LevelCount> SlotCount{1000, 60, 60, 24};
+    static constexpr uint64_t DayTicks = 86'400'000;
+
+    std::array<std::vector<std::vector<Entry>>, LevelCount> levels;
+    std::array<size_t, LevelCount> levelSize{};
+    std::vector<Entry> overflow;
+    // Inserted when already due, handed out by the next advance()
+    std::vector<Entry> due;
+    // Milliseconds since the steady_clock epoch, everything up to it was handed out
+    uint64_t current = 0;
+    bool started = false;
+
+    TimingWheel() {
+        for (size_t level = 0; level < LevelCount; level++) {
+            levels[level].resize(SlotCount[level]);
+        }
+    }
+
+    size_t size() const {
+        size_t total = overflow.size() + due.size();
+        for (auto count : levelSize) total += count;
+        return total;
+    }
+
+    // Rounded up, so an entry never comes out before its time
+    static uint64_t tickOf(time_point at) {
+        auto since = at.time_since_epoch();
+        auto ms = std::chrono::ceil<std::chrono::milliseconds>(since).count();
+        return ms < 0 ? 0 : uint64_t(ms);
+    }
+
+    static uint64_t floorTickOf(time_point at) {
+        auto ms = std::chrono::floor<std::chrono::milliseconds>(at.time_since_epoch()).count();
+        return ms < 0 ? 0 : uint64_t(ms);
+    }
+
+    void insert(T value, time_point at, time_point now) {
+        if (!started) {
+            current = floorTickOf(now);
+            started = true;
+        }
+        place(Entry{value, at});
+    }
+
+    // Moves time forward to now and appends every entry that came due to out
+    void advance(time_point now, std::vector<Entry>& out) {
+        uint64_t target = floorTickOf(now);
+        if (!started) {
+            current = target;
+            started = true;
+        }
+        out.insert(out.end(), due.begin(), due.end());
+        due.clear();
+
+        while (current < target) {
+            uint64_t next = nextInterestingTick();
+            if (next > target) {
+                current = target;
+                break;
+            }
+            current = next;
+            cascade();
+            auto& slot = levels[0][current % SlotCount[0]];
+            levelSize[0] -= slot.size();
+            out.insert(out.end(), slot.begin(), slot.end());
+            slot.clear();
+            // Cascaded entries that were already due at this boundary
+            out.insert(out.end(), due.begin(), due.end());
+            due.clear();
+        }
+    }
+
+    // Drops every entry pred returns true for, costs one pass over all slots
+    template <class Pred>
+    size_t removeIf(Pred pred) {
+        size_t removed = 0;
+        for (size_t level = 0; level < LevelCount; level++) {
+            for (auto& slot : levels[level]) {
+                size_t count = std::erase_if(slot, pred);
+                levelSize[level] -= count;
+                removed += count;
+            }
+        }
+        removed += std::erase_if(overflow, pred);
+        removed += std::erase_if(due, pred);
+        return removed;
+    }
+
+    void clear() {
+        for (size_t level = 0; level < LevelCount; level++) {
+            for (auto& slot : levels[level]) slot.clear();
+            levelSize[level] = 0;
+        }
+        overflow.clear();
+        due.clear();
+    }
+
+private:
+    void place(const Entry& entry) {
+        uint64_t tick = tickOf(entry.at);
+        if (tick <= current) {
+            due.push_back(entry);
+            return;
+        }
+        // Lowest level whose current slot span still contains the tick
+        for (size_t level = 0; level < LevelCount; level++) {
+            uint64_t span = SlotTicks[level] * SlotCount[level];
+            if (tick / span == current / span) {
+                levels[level][(tick / SlotTicks[level]) % SlotCount[level]].push_back(entry);
+                levelSize[level]++;
+                return;
+            }
+        }
+        overflow.push_back(entry);
+    }
+
+    // Next tick where a slot has to be looked at, skipping empty levels
+    uint64_t nextInterestingTick() const {
+        for (size_t level = 0; level < LevelCount; level++) {
+            if (levelSize[level] != 0) {
+                // Level 0 fires every tick, higher levels only matter on their own slot boundary
+                uint64_t step = SlotTicks[level];
+                return (current / step + 1) * step;
+            }
+        }
+        if (!overflow.empty()) return (current / DayTicks + 1) * DayTicks;
+        return UINT64_MAX;
+    }
+
+    // On a boundary, spreads the slot that just became current into the levels below
+    void cascade() {
+        if (current % DayTicks == 0) {
+            auto pending = std::move(overflow);
+            overflow.clear();
+            for (auto& entry : pending) place(entry);
+        }
+        for (size_t level = LevelCount - 1; level > 0; level--) {
+            if (current % SlotTicks[level] != 0) continue;
+            auto& slot = levels[level][(current / SlotTicks[level]) % SlotCount[level]];
+            if (slot.empty()) continue;
+            auto pending = std::move(slot);
+            slot.clear();
+            levelSize[level] -= pending.size();
+            for (auto& entry : pending) place(entry);
+        }
+    }
+};
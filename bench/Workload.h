@@ -0,0 +1,75 @@
+#pragma once
+
+// Seeded synthetic timers for benchmarks and soak tests.
+// The same config and seed always produce the same store (std distributions
+// are implementation defined, so only with the same standard library).
+
+#include <algorithm>
+#include <array>
+#include <random>
+#include <string>
+
+#include "TimerWise.h"
+
+struct WorkloadConfig {
+    size_t count = 1000;
+    uint32_t seed = 42;
+    // Name length is uniform in [minNameLength, maxNameLength], names stay unique
+    size_t minNameLength = 6;
+    size_t maxNameLength = 24;
+    // Chance of each weekday being set in a timer's mask
+    double dayChance = 0.6;
+    // Relative weights of daily, weekly, monthly and every_n_days timers
+    std::array<double, 4> typeMix{4, 3, 2, 1};
+    uint16_t maxInterval = 14;
+    std::chrono::seconds minDuration{60};
+    std::chrono::seconds maxDuration{4 * 3600};
+    // Fraction of the duration already elapsed, uniform in [minFill, maxFill]
+    double minFill = 0;
+    double maxFill = 1;
+};
+
+inline Timer make_workload_timer(const WorkloadConfig& config, size_t ind, std::mt19937& rng) {
+    static constexpr char Letters[] = "abcdefghijklmnopqrstuvwxyz ";
+    // The index suffix keeps names unique whatever length comes out
+    std::string suffix = "#" + std::to_string(ind);
+    std::uniform_int_distribution<size_t> lengthDist(config.minNameLength, std::max(config.minNameLength, config.maxNameLength));
+    size_t length = std::max(lengthDist(rng), suffix.size());
+    std::uniform_int_distribution<size_t> letterDist(0, sizeof(Letters) - 2);
+    std::string name;
+    name.reserve(length);
+    while (name.size() < length - suffix.size()) name += Letters[letterDist(rng)];
+    name += suffix;
+
+    std::bernoulli_distribution dayDist(config.dayChance);
+    WeekDays days = 0;
+    for (int day = 0; day < 7; day++) {
+        if (dayDist(rng)) days |= weekday_bit(day);
+    }
+
+    std::discrete_distribution<int> typeDist(config.typeMix.begin(), config.typeMix.end());
+    Period period{PeriodType(typeDist(rng)), 1};
+    if (period.type == PeriodType::EveryNDays) {
+        period.interval = std::uniform_int_distribution<uint16_t>(2, std::max<uint16_t>(2, config.maxInterval))(rng);
+    }
+
+    std::uniform_int_distribution<int64_t> durationDist(config.minDuration.count(), std::max(config.minDuration, config.maxDuration).count());
+    std::chrono::seconds duration{durationDist(rng)};
+
+    std::uniform_real_distribution<float> colorDist(0, 1);
+    Color color{colorDist(rng), colorDist(rng), colorDist(rng)};
+
+    Timer timer{std::move(name), duration, color, days, period};
+    std::uniform_real_distribution<double> fillDist(config.minFill, std::max(config.minFill, config.maxFill));
+    timer.timePassed = std::chrono::seconds(int64_t(duration.count() * fillDist(rng)));
+    return timer;
+}
+
+inline void generate_workload(TimerStore& timers, const WorkloadConfig& config) {
+    std::mt19937 rng(config.seed);
+    timers.clear();
+    timers.reserve(config.count);
+    for (size_t ind = 0; ind < config.count; ind++) {
+        timers.push_back(make_workload_timer(config, ind, rng));
+    }
+}
@@ -0,0 +1,406 @@
+// Microbenchmarks for the timer core at different store sizes.
+// Usage: timerwise_bench [--max N] [--out results.json]
+// Results are written as JSON so runs can be compared between releases.
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "AllocCounter.h"
+#include "BinarySnapshot.h"
+#include "Journal.h"
+#include "Snapshot.h"
+#include "TimerWise.h"
+#include "Workload.h"
+
+using namespace std::chrono_literals;
+
+struct BenchResult {
+    std::string name;
+    size_t timers;
+    size_t iterations;
+    double nsPerOp;
+    double allocsPerOp;
+    // Highest heap use above the starting point during one call
+    size_t peakBytes;
+    // Size of the file written, for the encoding benchmarks
+    size_t fileBytes = 0;
+};
+
+// Runs fn until at least minTime has passed, fn returns how many operations it did
+BenchResult measure(const std::string& name, size_t timers, const std::function<size_t()>& fn,
+                    std::chrono::milliseconds minTime = 200ms) {
+    size_t baseBytes = allocated_bytes;
+    peak_allocated_bytes = baseBytes;
+    fn();
+    size_t peakBytes = peak_allocated_bytes - baseBytes;
+    size_t ops = 0;
+    size_t iterations = 0;
+    size_t allocsBefore = allocation_count;
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::steady_clock::duration{};
+    do {
+        ops += fn();
+        iterations++;
+        elapsed = std::chrono::steady_clock::now() - start;
+    } while (elapsed < minTime);
+    size_t allocs = allocation_count - allocsBefore;
+
+    ops = std::max<size_t>(ops, 1);
+    BenchResult result{name, timers, iterations,
+                       double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / ops,
+                       double(allocs) / ops, peakBytes};
+    std::cerr << name << " n=" << timers << ": " << result.nsPerOp << " ns/op, "
+              << result.allocsPerOp << " allocs/op, " << result.peakBytes << " peak bytes\n";
+    return result;
+}
+
+void fill_store(TimerStore& timers, size_t count) {
+    WorkloadConfig config;
+    config.count = count;
+    generate_workload(timers, config);
+}
+
+// What main.cpp did before RunningTimers: advance and compare every running timer each frame
+struct ScanTimer {
+    std::chrono::seconds duration;
+    std::chrono::milliseconds timePassed;
+    std::chrono::steady_clock::time_point lastChecked;
+    bool running;
+};
+
+// False when a file didn't load back to what was saved
+bool bench_size(size_t count, const std::filesystem::path& dir, std::vector<BenchResult>& results) {
+    bool ok = true;
+    TimerStore timers;
+    fill_store(timers, count);
+    auto jsonPath = dir / ("timers_" + std::to_string(count) + ".json");
+    save_timer_vec(timers, jsonPath);
+
+    results.push_back(measure("load_timer_vec", count, [&] {
+        TimerStore loaded;
+        load_timer_vec(loaded, jsonPath);
+        return size_t{1};
+    }));
+
+    // How load_timer_vec worked before streaming: a whole DOM, then a Timer per element
+    results.push_back(measure("load_timer_dom", count, [&] {
+        TimerStore loaded;
+        std::ifstream f(jsonPath);
+        nlohmann::json json = nlohmann::json::parse(f);
+        loaded.reserve(json.size());
+        for (auto& j : json) loaded.push_back(Timer(j));
+        return size_t{1};
+    }));
+
+    // Startup with the binary snapshot instead of timers.json
+    std::vector<Timer> records;
+    for (size_t ind = 0; ind < timers.size(); ind++) records.push_back(timers.get(ind));
+    auto binPath = dir / ("timers_" + std::to_string(count) + ".bin");
+    save_timer_bin(records, binPath);
+    results.push_back(measure("load_timer_bin", count, [&] {
+        TimerStore loaded;
+        load_timer_bin(loaded, binPath);
+        return size_t{1};
+    }));
+
+    // A read-only consumer: map the snapshot and look at one timer
+    results.push_back(measure("bin_view_open", count, [&] {
+        TimerBinView view;
+        view.open(binPath);
+        volatile size_t sink = view.name(view.size() / 2).size();
+        (void)sink;
+        return size_t{1};
+    }));
+
+    // Summing durations straight out of the mapping, nothing is copied
+    results.push_back(measure("bin_view_scan", count, [&] {
+        TimerBinView view;
+        view.open(binPath);
+        int64_t total = 0;
+        for (size_t ind = 0; ind < view.size(); ind++) total += view.duration(ind).count();
+        volatile int64_t sink = total;
+        (void)sink;
+        return size_t{1};
+    }));
+
+    // Starting a few timers straight from the mapping, before the rest would be loaded
+    results.push_back(measure("bin_view_materialize", count, [&] {
+        TimerBinView view;
+        view.open(binPath);
+        TimerStore started;
+        RunningTimers running;
+        size_t ops = std::min<size_t>(view.size(), 16);
+        for (size_t ind = 0; ind < ops; ind++) {
+            size_t row = started.indexOf(view.materialize(started, ind * view.size() / ops));
+            if (row != TimerStore::NotFound) running.start(started, row, Clock::now);
+        }
+        return ops;
+    }));
+
+    {
+        TimerBinView view;
+        view.open(binPath);
+        TimerStore started;
+        TimerHandle first = view.materialize(started, 0);
+        // A second call finds the copy made by the first
+        bool same = first != NullTimer && view.materialize(started, 0) == first && started.count() == 1;
+
+        // Period type of the first record out of range
+        std::string damaged = TimerBin::encode(records);
+        damaged[TimerBin::HeaderSize + 37] = char(0xff);
+        auto damagedPath = dir / "damaged.bin";
+        atomic_write_file(damagedPath, damaged);
+        TimerBinView damagedView;
+        same = same && damagedView.open(damagedPath) && damagedView.materialize(started, 0) == NullTimer;
+        std::filesystem::remove(damagedPath);
+        if (!same) {
+            std::cerr << "materialize doesn't reuse timers or accept only valid records at " << count << " timers\n";
+            ok = false;
+        }
+    }
+
+    results.push_back(measure("save_timer_bin", count, [&] {
+        save_timer_bin(records, binPath);
+        return size_t{1};
+    }));
+
+    results.push_back(measure("save_timer_vec", count, [&] {
+        save_timer_vec(timers, jsonPath);
+        return size_t{1};
+    }));
+
+    results.push_back(measure("save_timer_vec_compact", count, [&] {
+        save_timer_vec(timers, jsonPath, JsonStyle::Compact);
+        return size_t{1};
+    }));
+
+    // How save_timer_vec worked before streaming: a json per timer, one for the array, then dump(4)
+    results.push_back(measure("save_timer_dom", count, [&] {
+        std::vector<nlohmann::json> jsonVec{};
+        for (size_t ind = 0; ind < timers.size(); ind++) {
+            if (timers.isAlive(ind)) jsonVec.push_back(timers.get(ind).to_json());
+        }
+        nlohmann::json json(jsonVec);
+        atomic_write_file(jsonPath, json.dump(4));
+        return size_t{1};
+    }));
+    results.back().fileBytes = std::filesystem::file_size(jsonPath);
+
+    // Every encoding against the dump(4) above, each one has to load back to the same timers
+    for (int encodingInd = 0; encodingInd < 4; encodingInd++) {
+        auto encoding = TimerEncoding(encodingInd);
+        std::string encodingName = TimerEncodingNames[encodingInd];
+        auto encodedPath = dir / ("timers_" + std::to_string(count) + "." + encodingName);
+        results.push_back(measure("save_" + encodingName, count, [&] {
+            save_timer_vec(records, encodedPath, encoding);
+            return size_t{1};
+        }));
+        results.back().fileBytes = std::filesystem::file_size(encodedPath);
+
+        results.push_back(measure("load_" + encodingName, count, [&] {
+            TimerStore loaded;
+            load_timer_vec(loaded, encodedPath);
+            return size_t{1};
+        }));
+
+        TimerStore loaded;
+        LoadError error;
+        bool same = load_timer_vec(loaded, encodedPath, &error) && loaded.size() == records.size();
+        for (size_t ind = 0; same && ind < records.size(); ind++) {
+            same = loaded.get(ind).to_json() == records[ind].to_json();
+        }
+        if (!same) {
+            std::cerr << encodingName << " doesn't round trip at " << count << " timers: " << error.message << "\n";
+            ok = false;
+        }
+        std::filesystem::remove(encodedPath);
+    }
+
+    // The part of a background save that still runs on the frame loop
+    results.push_back(measure("snapshot_capture", count, [&] {
+        Snapshot snapshot = Snapshot::capture(timers);
+        return size_t{1};
+    }));
+
+    // What one start or pause costs now, compared to rewriting timers.json above
+    Journal journal;
+    journal.open(dir / "journal.jsonl");
+    results.push_back(measure("journal_append", count, [&] {
+        size_t ops = std::min<size_t>(timers.size(), 256);
+        for (size_t ind = 0; ind < ops; ind++) journal.pause(timers, ind);
+        // What a checkpoint does once its snapshot is on disk
+        journal.rotate();
+        std::filesystem::remove(Journal::retiredPath(journal.path));
+        return ops;
+    }));
+
+    results.push_back(measure("reset_timer_vec", count, [&] {
+        // Force every boundary so the whole store is walked
+        Timer::cur_day = -1;
+        Timer::cur_week = -1;
+        Timer::cur_month = -1;
+        Timer::cur_epoch_day = -1;
+        reset_timer_vec(timers);
+        return size_t{1};
+    }));
+
+    results.push_back(measure("today_filter", count, [&] {
+        WeekDays today = weekday_bit(Clock::date.wday);
+        size_t visible = 0;
+        for (size_t ind = 0; ind < timers.size(); ind++) {
+            visible += timers.availableOn(ind, today) && !timers.isRunning(ind);
+        }
+        volatile size_t sink = visible;
+        (void)sink;
+        return size_t{1};
+    }));
+
+    std::vector<std::string> names;
+    std::mt19937 rng(7);
+    for (size_t ind = 0; ind < std::min<size_t>(count, 4096); ind++) {
+        names.push_back(std::string(timers.meta[rng() % count].name));
+    }
+    results.push_back(measure("get_timer_from_name", count, [&] {
+        size_t found = 0;
+        for (auto& name : names) found += get_timer_from_name(timers, name) != NullTimer;
+        volatile size_t sink = found;
+        (void)sink;
+        return names.size();
+    }));
+
+    // One 16 ms frame of countdown text for every timer, all of them running
+    VirtualClock clock{time(0), std::chrono::steady_clock::time_point{} + 1000h};
+    Clock::use(clock);
+    Clock::tick();
+    RunningTimers running;
+    for (size_t ind = 0; ind < timers.size(); ind++) running.start(timers, ind, Clock::now);
+    results.push_back(measure("getFormattedTimePassed", count, [&] {
+        clock.advance(16ms);
+        Clock::tick();
+        size_t length = 0;
+        for (size_t ind = 0; ind < timers.size(); ind++) length += timers.getFormattedTimePassed(ind).size();
+        volatile size_t sink = length;
+        (void)sink;
+        return timers.size();
+    }));
+
+    // Per-frame completion check: timing wheel vs scanning every running timer
+    results.push_back(measure("expiry_wheel_frame", count, [&] {
+        clock.advance(16ms);
+        Clock::tick();
+        running.expire(timers, Clock::now);
+        return size_t{1};
+    }));
+
+    std::vector<ScanTimer> scan(count);
+    for (size_t ind = 0; ind < count; ind++) {
+        scan[ind] = ScanTimer{timers.duration[ind], {}, Clock::now, true};
+    }
+    results.push_back(measure("expiry_scan_frame", count, [&] {
+        clock.advance(16ms);
+        Clock::tick();
+        for (auto& timer : scan) {
+            if (!timer.running) continue;
+            timer.timePassed += std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now - timer.lastChecked);
+            timer.lastChecked = Clock::now;
+            if (timer.timePassed >= timer.duration) timer.running = false;
+        }
+        return size_t{1};
+    }));
+
+    // Start and pause churn, lazy cancellation keeps both O(1)
+    results.push_back(measure("start_pause", count, [&] {
+        size_t ops = std::min<size_t>(timers.size(), 4096);
+        for (size_t ind = 0; ind < ops; ind++) {
+            running.pause(timers, ind, Clock::now);
+            running.start(timers, ind, Clock::now);
+        }
+        return ops;
+    }));
+
+    // A simulated day of one minute frames on the virtual clock, with rollover at midnight
+    for (size_t ind = 0; ind < timers.size(); ind++) running.pause(timers, ind, Clock::now);
+    RolloverScheduler rollover;
+    rollover.schedule(Clock::wallNow);
+    results.push_back(measure("simulate_day", count, [&] {
+        for (size_t ind = 0; ind < timers.size(); ind += 16) running.start(timers, ind, Clock::now);
+        for (int minute = 0; minute < 24 * 60; minute++) {
+            clock.advance(1min);
+            Clock::tick();
+            running.expire(timers, Clock::now);
+            if (rollover.due(Clock::wallNow)) {
+                reset_timer_vec(timers);
+                running.reschedule(timers, Clock::now);
+                rollover.schedule(Clock::wallNow);
+            }
+        }
+        return size_t{1};
+    }));
+
+    static SystemClock systemClock;
+    Clock::use(systemClock);
+    std::filesystem::remove(jsonPath);
+    std::filesystem::remove(binPath);
+    std::filesystem::remove(dir / "journal.jsonl");
+    std::filesystem::remove(Journal::retiredPath(dir / "journal.jsonl"));
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    size_t maxTimers = 1'000'000;
+    std::filesystem::path out;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--max") && i + 1 < argc) {
+            maxTimers = std::stoull(argv[++i]);
+        } else if (!strcmp(argv[i], "--out") && i + 1 < argc) {
+            out = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--max N] [--out results.json]\n";
+            return 1;
+        }
+    }
+
+    auto dir = std::filesystem::temp_directory_path() / "timerwise_bench";
+    std::filesystem::create_directories(dir);
+    Clock::tick();
+
+    std::vector<BenchResult> results;
+    bool ok = true;
+    for (size_t count : {size_t{10}, size_t{1'000}, size_t{100'000}, size_t{1'000'000}}) {
+        if (count > maxTimers) break;
+        ok = bench_size(count, dir, results) && ok;
+    }
+
+    nlohmann::json json;
+#ifdef NDEBUG
+    json["context"]["build"] = "release";
+#else
+    json["context"]["build"] = "debug";
+#endif
+    json["context"]["date"] = Clock::wallNow;
+    json["benchmarks"] = nlohmann::json::array();
+    for (auto& result : results) {
+        nlohmann::json entry{{"name", result.name},
+                             {"timers", result.timers},
+                             {"iterations", result.iterations},
+                             {"ns_per_op", result.nsPerOp},
+                             {"allocs_per_op", result.allocsPerOp},
+                             {"peak_bytes", result.peakBytes}};
+        if (result.fileBytes != 0) entry["file_bytes"] = result.fileBytes;
+        json["benchmarks"].push_back(entry);
+    }
+
+    if (out.empty()) {
+        std::cout << json.dump(2) << std::endl;
+    } else {
+        std::ofstream f(out, std::ofstream::trunc);
+        f << json.dump(2) << std::endl;
+    }
+    return ok ? 0 : 1;
+}
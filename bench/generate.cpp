@@ -0,0 +1,94 @@
+// Writes a synthetic timers.json and days.txt for benchmarks and soak tests.
+// Usage: timerwise_gen [options] <output dir>
+//   --count N          number of timers (default 1000)
+//   --seed N           random seed (default 42)
+//   --name-length A:B  name length range (default 6:24)
+//   --day-chance P     chance of each weekday being set (default 0.6)
+//   --types D,W,M,N    weights of daily, weekly, monthly, every_n_days (default 4,3,2,1)
+//   --max-interval N   longest every_n_days interval (default 14)
+//   --fill A:B         elapsed fraction of the duration (default 0:1)
+//   --days-ago N       date saved in days.txt, so the next load rolls over (default 0)
+//   --encoding E       json, cbor, msgpack or ubjson (default json)
+
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include "Workload.h"
+
+static bool parse_range(const char* arg, double& low, double& high) {
+    char colon;
+    std::istringstream in(arg);
+    return bool(in >> low >> colon >> high) && colon == ':' && low <= high;
+}
+
+static int usage(const char* name) {
+    std::cerr << "Usage: " << name << " [--count N] [--seed N] [--name-length A:B] [--day-chance P]\n"
+              << "       [--types D,W,M,N] [--max-interval N] [--fill A:B] [--days-ago N]\n"
+              << "       [--encoding json|cbor|msgpack|ubjson] <output dir>\n";
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    WorkloadConfig config;
+    int daysAgo = 0;
+    TimerEncoding encoding = TimerEncoding::Json;
+    std::filesystem::path dir;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg[0] != '-') {
+            dir = arg;
+            continue;
+        }
+        if (!value) return usage(argv[0]);
+        i++;
+        if (!strcmp(arg, "--count")) {
+            config.count = std::stoull(value);
+        } else if (!strcmp(arg, "--seed")) {
+            config.seed = uint32_t(std::stoul(value));
+        } else if (!strcmp(arg, "--name-length")) {
+            double low, high;
+            if (!parse_range(value, low, high)) return usage(argv[0]);
+            config.minNameLength = size_t(low);
+            config.maxNameLength = size_t(high);
+        } else if (!strcmp(arg, "--day-chance")) {
+            config.dayChance = std::clamp(std::stod(value), 0.0, 1.0);
+        } else if (!strcmp(arg, "--types")) {
+            char comma;
+            std::istringstream in(value);
+            auto& mix = config.typeMix;
+            if (!(in >> mix[0] >> comma >> mix[1] >> comma >> mix[2] >> comma >> mix[3])) return usage(argv[0]);
+        } else if (!strcmp(arg, "--max-interval")) {
+            config.maxInterval = uint16_t(std::stoul(value));
+        } else if (!strcmp(arg, "--fill")) {
+            if (!parse_range(value, config.minFill, config.maxFill)) return usage(argv[0]);
+        } else if (!strcmp(arg, "--days-ago")) {
+            daysAgo = std::stoi(value);
+        } else if (!strcmp(arg, "--encoding")) {
+            auto name = std::find_if(std::begin(TimerEncodingNames), std::end(TimerEncodingNames),
+                                     [&](const char* known) { return !strcmp(known, value); });
+            if (name == std::end(TimerEncodingNames)) return usage(argv[0]);
+            encoding = TimerEncoding(name - std::begin(TimerEncodingNames));
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (dir.empty()) return usage(argv[0]);
+    std::filesystem::create_directories(dir);
+
+    TimerStore timers;
+    generate_workload(timers, config);
+    std::vector<Timer> records;
+    records.reserve(timers.size());
+    for (size_t ind = 0; ind < timers.size(); ind++) records.push_back(timers.get(ind));
+    save_timer_vec(records, dir / "timers.json", encoding);
+
+    Clock::tick();
+    Timer::update_calendar(CalendarDate::from(CalendarDate::midnight(Clock::wallNow, -daysAgo)));
+    std::ofstream days(dir / "days.txt", std::ofstream::trunc);
+    days << format_date();
+
+    std::cerr << "Wrote " << timers.count() << " timers to " << dir.string() << "\n";
+    return 0;
+}
@@ -5,6 +5,7 @@
 #include <imgui_internal.h>
 #include <imgui_impl_sdl2.h>
 #include <imgui_impl_opengl3.h>
+#include <imgui_stdlib.h>
 
 #define NO_STDIO_REDIRECT
 #include <SDL.h>
@@ -15,56 +16,65 @@
 #include <SDL_opengl.h>
 #endif
 
+#include <cstdio>
+#include <filesystem>
 #include <iostream>
+#include <memory_resource>
+#include <ranges>
+#include <unordered_map>
 #include <utility>
 #include "TimerWise.h"
+#include "BinarySnapshot.h"
+#include "Journal.h"
+#include "Snapshot.h"
+#ifdef TIMERWISE_COUNT_ALLOCS
+#include "AllocCounter.h"
+#endif
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
 // TODO: Those should be configurable
 const std::filesystem::path DataDir = std::filesystem::current_path() / "data";
 const std::filesystem::path TimersFilePath = DataDir / "timers.json";
+const std::filesystem::path TimersBinPath = DataDir / "timers.bin";
 const std::filesystem::path DaysFilePath = DataDir / "days.txt";
-constexpr char* timerTypes[2] = {"daily", "weekly"};
-constexpr char* timeUnits[3] = {"seconds", "minutes", "hours"};
+const std::filesystem::path JournalFilePath = DataDir / "journal.jsonl";
+constexpr std::chrono::seconds AutosaveInterval{30};
+// How often running timers get a progress record in the journal
+constexpr std::chrono::seconds ProgressInterval{30};
+// What timers.json is written in, any of them loads
+constexpr TimerEncoding StorageEncoding = TimerEncoding::Json;
+constexpr const char* timeUnits[3] = {"seconds", "minutes", "hours"};
+
+// Scratch memory for strings that only live until the end of the frame.
+// Falls back to the heap if a frame ever needs more than the buffer.
+struct FrameArena {
+    std::array<std::byte, 16 * 1024> buffer;
+    std::pmr::monotonic_buffer_resource resource{buffer.data(), buffer.size()};
+
+    // Call after ImGui::Render(), nothing allocated this frame may be used afterwards
+    void reset() { resource.release(); }
+};
+FrameArena frameArena{};
 
 struct TimerInput {
-    char name[20];
+    // Grows with the text, so editing never shortens a name
+    std::string name;
     int times[3];
     float color[3];
     int timerTypeInd;
-    std::unordered_map<std::string, bool>weekDaysSel;
-
-    TimerInput() :  name(), times(), timerTypeInd(0), color() {
-        weekDaysSel = {
-            {"Monday",true},
-            {"Tuesday",true},
-            {"Wednesday",true},
-            {"Thursday",true},
-            {"Friday",true},
-            {"Saturday",true},
-            {"Sunday",true}
-        };
-    }
-    TimerInput(Timer& timer) :  name(), times(), color() {
-        strcpy_s(name, timer.name.c_str());
-        timerTypeInd = (timer.type == "daily") ? 0 : 1;
+    int interval;
+    WeekDays weekDaysSel;
+
+    TimerInput() :  name(), times(), timerTypeInd(0), interval(1), color(), weekDaysSel(AllWeekDays) {}
+    TimerInput(const Timer& timer) :  name(timer.name), times(), color() {
+        timerTypeInd = int(timer.type.type);
+        interval = timer.type.interval;
         timer.getDurationArr(times);
         color[0] = timer.timerColor.r;
         color[1] = timer.timerColor.g;
         color[2] = timer.timerColor.b;
-        weekDaysSel = {
-            {"Monday",false},
-            {"Tuesday",false},
-            {"Wednesday",false},
-            {"Thursday",false},
-            {"Friday",false},
-            {"Saturday",false},
-            {"Sunday",false}
-        };
-        for(auto& day: timer.days) {
-            weekDaysSel[day] = true;
-        }
+        weekDaysSel = timer.days;
     }
 };
 
@@ -88,25 +98,59 @@ unsigned int load_texture(std::filesystem::path file_path) {
     return textureID;
 }
 
-void loadFiles(std::vector<Timer>& timers) {
+// Hands a snapshot to the writer thread, the journal records it covers are
+// dropped once it's on disk. Skipped while the previous one is still written.
+bool saveFiles(const TimerStore& timers, Journal& journal, SnapshotWriter& writer, bool writeJson = false) {
+    if (writer.busy()) return false;
+    journal.rotate();
+    Snapshot snapshot = Snapshot::capture(timers);
+    snapshot.writeJson = writeJson;
+    writer.submit(std::move(snapshot), [retired = Journal::retiredPath(journal.path)] {
+        // Runs on the writer thread, a throw there would terminate the app.
+        // A file that stays behind is replayed once more, which changes nothing.
+        std::error_code error;
+        std::filesystem::remove(retired, error);
+    });
+    return true;
+}
+
+void loadFiles(TimerStore& timers, Journal& journal, SnapshotWriter& writer) {
     if (std::filesystem::is_directory(DataDir) == 0) {
         std::filesystem::create_directory(DataDir);
     }
    
-    if (!std::filesystem::exists(TimersFilePath)) {
-        std::ofstream output(TimersFilePath);
-        output << "";
-        output.close();
-    }
-    else {
-        std::fstream f(TimersFilePath);
-        if (!f.is_open()) return;
-
-        nlohmann::json json = nlohmann::json::parse(f);
-        for (auto &j : json) {
-            timers.push_back(Timer(j));
+    // A timers.json newer than the binary copy was replaced by hand, it wins
+    std::error_code error;
+    bool preferBin = std::filesystem::exists(TimersBinPath) &&
+        (!std::filesystem::exists(TimersFilePath) ||
+         std::filesystem::last_write_time(TimersBinPath, error) >= std::filesystem::last_write_time(TimersFilePath, error));
+    if (!preferBin || !load_timer_bin(timers, TimersBinPath)) {
+        if (!std::filesystem::exists(TimersFilePath)) {
+            std::ofstream output(TimersFilePath);
+            output << "";
+            output.close();
+        }
+        else {
+            LoadError error;
+            if (!load_timer_vec(timers, TimersFilePath, &error)) {
+                // The next save overwrites the file, keep what couldn't be read
+                auto broken = TimersFilePath;
+                broken += ".broken";
+                std::error_code copyError;
+                std::filesystem::copy_file(TimersFilePath, broken, std::filesystem::copy_options::overwrite_existing, copyError);
+                std::cerr << TimersFilePath.string() << ": byte " << error.offset << ": " << error.message;
+                if (copyError) {
+                    std::cerr << ", couldn't keep a copy in " << broken.string() << ": " << copyError.message() << std::endl;
+                } else {
+                    std::cerr << ", kept a copy in " << broken.string() << std::endl;
+                }
+            }
+            // The startup snapshot below keeps the new names
+            if (error.renamed != 0) {
+                std::cerr << TimersFilePath.string() << ": renamed " << error.renamed
+                          << " timers with a name that was already taken" << std::endl;
+            }
         }
-        f.close(); 
     }
 
     if(!std::filesystem::exists(DaysFilePath)) {
@@ -114,22 +158,14 @@ void loadFiles(std::vector<Timer>& timers) {
         std::ofstream output(DaysFilePath);
         output << "";
         output.close();
-        reset_timer_vec(timers);
     }else {
-        std::fstream f(DaysFilePath);
-        if (!f.is_open()) return;
-        std::stringstream s{};
-        s << f.rdbuf();
-        std::string buf = s.str();
-        f.close();
-
-        auto ind = buf.find(' ');
-        Timer::cur_day = stoi(buf.substr(0, ind));
-        if (ind != buf.length()) {
-            Timer::cur_week = stoi(buf.substr(ind, buf.length() - ind));
-        }
-        reset_timer_vec(timers);
+        load_date(DaysFilePath);
     }
+    // Changes made after the last snapshot, if the app didn't exit cleanly
+    replay_journal(timers, JournalFilePath);
+    reset_timer_vec(timers);
+    journal.open(JournalFilePath);
+    saveFiles(timers, journal, writer);
 }
 
 constexpr int timeSumInSec(int seconds, int minutes = 0, int hours = 0) {
@@ -137,7 +173,7 @@ constexpr int timeSumInSec(int seconds, int minutes = 0, int hours = 0) {
 }
 
 // Circle code taken from: https://github.com/ocornut/imgui/issues/2020
-auto ProgressCircle(float progress, float radius, float thickness, std::string time, const ImColor& color, const ImColor& textColor={255,255,255}) {
+auto ProgressCircle(float progress, float radius, float thickness, std::string_view time, const ImColor& color, const ImColor& textColor={255,255,255}) {
     ImVec2 offset{ 0,20 };
     auto window = ImGui::GetCurrentWindow();
     if (window->SkipItems) return;
@@ -160,8 +196,8 @@ auto ProgressCircle(float progress, float radius, float thickness, std::string t
     window->DrawList->PathStroke(ImGui::GetColorU32(ImVec4(0.2,0.2,0.2,0.5)), false, thickness);
 
     // Counter
-    auto timeSize = ImGui::CalcTextSize(time.c_str())/2;
-    window->DrawList->AddText({ center.x-timeSize.x, center.y-timeSize.y }, textColor, time.c_str());
+    auto timeSize = ImGui::CalcTextSize(time.data(), time.data() + time.size())/2;
+    window->DrawList->AddText({ center.x-timeSize.x, center.y-timeSize.y }, textColor, time.data(), time.data() + time.size());
 
     // Hitbox
     const ImRect bb{ pos , pos + size + offset * 2};
@@ -176,19 +212,21 @@ auto ProgressCircle(float progress, float radius, float thickness, std::string t
     window->DrawList->PathStroke(color, false, thickness);
 }
 
-void displayTimerCircle(Timer& timer, float radius, float thickness, ImVec2 offset = {0,0}) {
-    float progress = timer.getTimePassed() / timer.getDuration();
+void displayTimerCircle(TimerStore& timers, size_t ind, float radius, float thickness, ImVec2 offset = {0,0}) {
+    auto& meta = timers.meta[ind];
+    float progress = timers.getTimePassed(ind) / timers.getDuration(ind);
     ImGui::SetCursorPos(ImGui::GetCursorPos() + offset - ImVec2(radius,0));
-    auto counterCol = (timer.type == "weekly") ? ImColor{255, 216, 0} : ImColor{255, 255, 255};
-    ProgressCircle(progress, radius, thickness, timer.getFormattedTimePassed(), ImColor(timer.timerColor.r, timer.timerColor.g, timer.timerColor.b), counterCol);
+    auto counterCol = (timers.type[ind].type == PeriodType::Weekly) ? ImColor{255, 216, 0} : ImColor{255, 255, 255};
+    ProgressCircle(progress, radius, thickness, timers.getFormattedTimePassed(ind), ImColor(meta.timerColor.r, meta.timerColor.g, meta.timerColor.b), counterCol);
 
-    std::string text = timer.name;
+    std::pmr::string text{meta.name, &frameArena.resource};
     if (text.length() > 17) {
-        text = text.substr(0, 17) + "...";
+        text.resize(17);
+        text += "...";
     }
-    auto textOff = ImGui::CalcTextSize(text.c_str())*0.5f;
+    auto textOff = ImGui::CalcTextSize(text.data(), text.data() + text.size())*0.5f;
     ImGui::SetCursorPos(ImGui::GetCursorPos() + offset - textOff);
-    ImGui::Text(text.c_str());
+    ImGui::TextUnformatted(text.data(), text.data() + text.size());
 }
 
 
@@ -242,9 +280,17 @@ int main(int, char**)
     ImGui_ImplOpenGL3_Init(glsl_version);
 
     std::unordered_map<std::string, unsigned int>textures{};
-    std::vector<Timer> timers{};
-    size_t active_timer = -1;
-    loadFiles(timers);
+    TimerStore timers{};
+    RunningTimers running{};
+    Journal journal{};
+    SnapshotWriter writer{TimersFilePath, TimersBinPath, DaysFilePath};
+    writer.encoding = StorageEncoding;
+    Clock::tick();
+    loadFiles(timers, journal, writer);
+    RolloverScheduler rollover{};
+    rollover.schedule(Clock::wallNow);
+    AutosavePolicy autosave{AutosaveInterval};
+    auto nextProgress = Clock::now + ProgressInterval;
 
     unsigned int play_texture = load_texture(DataDir / "play.png");
     unsigned int config_texture = load_texture(DataDir / "config.png");
@@ -252,9 +298,15 @@ int main(int, char**)
     unsigned int pause_texture = load_texture(DataDir / "pause.png");
 
     TimerInput timerInput{};
+    // Why the last Save was refused, shown until the popup closes
+    const char* timerInputError = nullptr;
     ImGuiID timerConfigPopupID = ImHashStr( "Timer Config" );
-    Timer* edited_timer = nullptr;
-    std::vector<std::string> timers_to_remove{};
+    TimerHandle edited_timer = NullTimer;
+    std::vector<TimerHandle> timers_to_remove{};
+
+#ifdef TIMERWISE_COUNT_ALLOCS
+    size_t frame_allocations = 0;
+#endif
 
     bool show_demo_window = false;
     ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
@@ -264,8 +316,10 @@ int main(int, char**)
     while (!done)
     {
         SDL_Event event;
+        bool idle = true;
         while (SDL_PollEvent(&event))
         {
+            idle = false;
             ImGui_ImplSDL2_ProcessEvent(&event);
             if (event.type == SDL_QUIT)
                 done = true;
@@ -273,24 +327,43 @@ int main(int, char**)
                 done = true;
         }
 
+#ifdef TIMERWISE_COUNT_ALLOCS
+        size_t allocations_at_frame_start = allocation_count;
+#endif
+        Clock::tick();
+
         if(timers_to_remove.size() != 0) {
-            for(auto& tname: timers_to_remove) {
-                timers.erase(std::remove_if(timers.begin(), timers.end(), [tname](Timer& t) {return (t.name==tname);}),timers.end());
+            for(auto& handle: timers_to_remove) {
+                size_t ind = timers.indexOf(handle);
+                if (ind == TimerStore::NotFound) continue;
+                journal.remove(timers, ind);
+                timers.erase(handle);
             }
             timers_to_remove.clear();
         }
-
-        if (active_timer == -1) {
-            reset_timer_vec(timers); 
-        }else {
-            timers[active_timer].timePassed +=
-                std::chrono::duration_cast<std::chrono::milliseconds>(
-                (std::chrono::steady_clock::now() - timers[active_timer].lastChecked));
-
-            timers[active_timer].lastChecked = std::chrono::steady_clock::now();
-            if (timers[active_timer].timePassed >= timers[active_timer].duration) {
-                active_timer = -1;
+        timers.compactIfNeeded(idle);
+
+        running.expire(timers, Clock::now);
+        for (size_t ind : running.finished) journal.complete(timers, ind);
+        if (rollover.due(Clock::wallNow)) {
+            reset_timer_vec(timers);
+            running.reschedule(timers, Clock::now);
+            rollover.schedule(Clock::wallNow);
+            journal.rollover();
+        }
+        // Running timers only move in memory, a few bytes per timer keep that progress.
+        // Full snapshots are left to real changes, the checkpoint and exit.
+        if (timers.runningCount == 0) {
+            nextProgress = Clock::now + ProgressInterval;
+        } else if (Clock::now >= nextProgress) {
+            for (size_t ind = 0; ind < timers.size(); ind++) {
+                if (timers.isRunning(ind)) journal.progress(timers, ind);
             }
+            nextProgress = Clock::now + ProgressInterval;
+        }
+        if (journal.changes != 0) autosave.markDirty(Clock::now);
+        if (autosave.due(Clock::now) || journal.needsCheckpoint()) {
+            if (saveFiles(timers, journal, writer)) autosave.saved();
         }
 
         // Start the Dear ImGui frame
@@ -313,15 +386,44 @@ int main(int, char**)
                     ImGui::OpenPopup("Timer Config");
                     ImGui::PopID();
                 }
+#ifdef TIMERWISE_COUNT_ALLOCS
+                ImGui::Text("Allocations last frame: %zu", frame_allocations);
+#endif
                 ImGui::EndMenuBar();
             }
 
-            if (active_timer != -1) {
+            if (timers.runningCount == 1) {
                 const float radius = 40.f;
 
                 float avail = ImGui::GetContentRegionAvail().x;
                 float off = (avail - radius) * 0.5f;
-                displayTimerCircle(timers[active_timer], radius, 20.f, ImVec2(ImGui::GetCursorPosX() + off,0));
+                size_t active = 0;
+                while (!timers.isRunning(active)) active++;
+                displayTimerCircle(timers, active, radius, 20.f, ImVec2(ImGui::GetCursorPosX() + off,0));
+                ImGui::SetCursorPosX(ImGui::GetCursorPosX() + off + radius * 0.5f);
+                ImGui::PushStyleColor(ImGuiCol_Button, ImVec4{ 0,0,0,0 });
+                if (ImGui::ImageButton((void*)(intptr_t)pause_texture, ImVec2{ 10, 11})) {
+                    running.pause(timers, active, Clock::now);
+                    journal.pause(timers, active);
+                }
+                ImGui::PopStyleColor();
+            } else if (timers.runningCount > 1 && ImGui::BeginTable("RunningTimers", 6)) {
+                float columnOffset = 50.f;
+                for (size_t timer = 0; timer < timers.size(); timer++) {
+                    if (!timers.isRunning(timer)) continue;
+                    ImGui::TableNextColumn();
+                    displayTimerCircle(timers, timer, 30.f, 15.f, ImVec2{columnOffset,0.f});
+                    ImGui::SetCursorPosX(ImGui::GetCursorPosX() + (columnOffset/2));
+                    ImGui::PushStyleColor(ImGuiCol_Button, ImVec4{ 0,0,0,0 });
+                    ImGui::PushID(int(timer));
+                    if (ImGui::ImageButton((void*)(intptr_t)pause_texture, ImVec2{ 10, 11})) {
+                        running.pause(timers, timer, Clock::now);
+                        journal.pause(timers, timer);
+                    }
+                    ImGui::PopID();
+                    ImGui::PopStyleColor();
+                }
+                ImGui::EndTable();
             }
 
             ImGui::SeparatorText("Timers for Today");
@@ -329,50 +431,35 @@ int main(int, char**)
                 int ind = 0;
                 float columnOffset = 50.f;
                 float timerRadius = 30.f;
-                // TODO: Change this
-                static const char* days[] = {
-                    "Sunday", "Monday", "Tuesday", "Wednesday", 
-                    "Thursday", "Friday", "Saturday"
-                };
-                static auto f = [&](Timer& timer) {
-                    bool valid = false;
-                    if (timer.days.size() != 0) {
-                        for (auto timer_day : timer.days) {
-                            if(timer_day == days[Timer::get_datetime().tm_wday]) valid=true;
-                        }
-                    }
-                    if(valid) {
-                        if(active_timer==-1) return true;
-                        return !(timer.name == timers[active_timer].name);
-                    }else {
-                        return false;
-                    }
+                WeekDays today = weekday_bit(Clock::date.wday);
+                auto f = [&](size_t timer) {
+                    return timers.availableOn(timer, today) && !timers.isRunning(timer);
                 };
-                for (auto& timer : timers | std::views::filter(f)) {
+                for (size_t timer : std::views::iota(size_t{0}, timers.size()) | std::views::filter(f)) {
                     ImGui::TableNextColumn();
-                    displayTimerCircle(timer, timerRadius, 15.f, ImVec2{columnOffset,0.f});
+                    displayTimerCircle(timers, timer, timerRadius, 15.f, ImVec2{columnOffset,0.f});
                     // TODO: Fix weird offset
                     ImGui::SetCursorPosX(ImGui::GetCursorPosX() + (columnOffset/2));
                     ImGui::PushStyleColor(ImGuiCol_Button, ImVec4{ 0,0,0,0 });
                     ImGui::PushID(ind);
 
-                    if (ImGui::ImageButton((void*)play_texture, ImVec2{ 10, 11})) {
-                        timer.lastChecked = std::chrono::steady_clock::now();
-                        active_timer = get_timer_from_name(timers, timer.name);
+                    if (ImGui::ImageButton((void*)(intptr_t)play_texture, ImVec2{ 10, 11})) {
+                        running.start(timers, timer, Clock::now);
+                        journal.start(timers, timer);
                     }
                     ImGui::SameLine(0.f, 0.f);
-                    if(ImGui::ImageButton((void*)config_texture, ImVec2{11,11})) {
+                    if(ImGui::ImageButton((void*)(intptr_t)config_texture, ImVec2{11,11})) {
                         // TODO: Pass by pointer
-                        timerInput = TimerInput(timer);
-                        edited_timer = &timer;
+                        timerInput = TimerInput(timers.get(timer));
+                        edited_timer = timers.handleAt(timer);
                         ImGui::PushOverrideID(timerConfigPopupID);
                         ImGui::OpenPopup("Timer Config");
                         ImGui::PopID();
                     }
                     ImGui::SameLine(0.f, 0.f);
                     // TODO: Add "are you sure?" popup
-                    if(ImGui::ImageButton((void*)remove_texture, ImVec2{11,11})) {
-                        timers_to_remove.push_back(timer.name);
+                    if(ImGui::ImageButton((void*)(intptr_t)remove_texture, ImVec2{11,11})) {
+                        timers_to_remove.push_back(timers.handleAt(timer));
                     }
                     ImGui::PopStyleColor();
                     ImGui::PopID();
@@ -382,59 +469,69 @@ int main(int, char**)
             }
             ImGui::PushOverrideID(timerConfigPopupID);
             if(ImGui::BeginPopupModal("Timer Config")) {
-                ImGui::InputText("Name", timerInput.name, sizeof(timerInput.name));
+                ImGui::InputText("Name", &timerInput.name);
                 ImGui::InputInt3("Time", timerInput.times);
                 ImGui::ColorEdit3("Timer Color", timerInput.color);
-                static_assert(sizeof(timerTypes)/sizeof(timerTypes[0]) == 2, "Only two types of timers are supported");
-                ImGui::Combo("Timer Type", &timerInput.timerTypeInd, timerTypes, 2);
+                ImGui::Combo("Timer Type", &timerInput.timerTypeInd, PeriodTypeNames, IM_ARRAYSIZE(PeriodTypeNames));
+                if (PeriodType(timerInput.timerTypeInd) == PeriodType::EveryNDays) {
+                    ImGui::InputInt("Every N days", &timerInput.interval);
+                    timerInput.interval = std::clamp(timerInput.interval, 1, 365);
+                }
                 ImGui::Text("Timer available at: ");
                 if (ImGui::BeginTable("Days", 7, ImGuiTableFlags_Borders, ImVec2(ImGui::GetWindowWidth()*0.4, 1.5))) {
-                    for (auto& day : timerInput.weekDaysSel) {
+                    // Week starts on Monday
+                    for (int i = 1; i <= 7; i++) {
+                        int wday = i % 7;
+                        bool selected = timerInput.weekDaysSel & weekday_bit(wday);
                         ImGui::TableNextColumn();
-                        if(ImGui::Selectable(day.first.substr(0,3).c_str(), day.second, ImGuiSelectableFlags_DontClosePopups)) day.second = !day.second;
+                        if(ImGui::Selectable(DaysOfWeekShort[wday], selected, ImGuiSelectableFlags_DontClosePopups)) timerInput.weekDaysSel ^= weekday_bit(wday);
                     }
                     ImGui::EndTable();
                 }
 
                 // TODO: Breaks
                 // Break every/after x h/min/secs for x h/min/secs
+                if (timerInputError) ImGui::TextColored(ImVec4(1.f, 0.4f, 0.4f, 1.f), "%s", timerInputError);
                 if (ImGui::Button("Save")) {
-                    bool valid = true;
-                    // TODO: Proper error
-                    if (sizeof(timerInput.name) == 0) valid = false;
+                    timerInputError = nullptr;
+                    if (timerInput.name.empty()) timerInputError = "Name can't be empty";
 
                     int total = timeSumInSec(timerInput.times[2], timerInput.times[1], timerInput.times[0]);
-                    // TODO: Proper error
-                    if (total == 0) valid = false;
+                    if (total <= 0) timerInputError = "Time has to be longer than 0";
 
-                    std::vector<std::string> days;
-                    for (auto& day : timerInput.weekDaysSel) {
-                        if (!day.second) continue;
-                        days.push_back(day.first);
-                    }
+                    TimerHandle existing = timers.find(timerInput.name);
+                    if (existing != NullTimer && existing != edited_timer) timerInputError = "A timer with this name already exists";
+
+                    WeekDays days = timerInput.weekDaysSel;
+                    Period period{PeriodType(timerInput.timerTypeInd), uint16_t(timerInput.interval)};
 
-                    // TODO: Error when returns 1
-                    if (valid) {
-                        if(edited_timer !=nullptr) { 
-                            auto time_passed = edited_timer->timePassed;
-                            *edited_timer = Timer(timerInput.name, std::chrono::seconds{ total }, 
+                    // Stays open so the input can be fixed
+                    if (!timerInputError) {
+                        if(edited_timer != NullTimer) { 
+                            size_t edited = timers.indexOf(edited_timer);
+                            std::string oldName = edited != TimerStore::NotFound ? std::string(timers.meta[edited].name) : std::string();
+                            if (edited != TimerStore::NotFound && timers.set(edited, Timer(timerInput.name, std::chrono::seconds{ total }, 
                                 Color(timerInput.color[0], timerInput.color[1], timerInput.color[2]), 
-                                days, timerTypes[timerInput.timerTypeInd]);
-                            edited_timer->timePassed = time_passed;
+                                days, period))) {
+                                if (timers.isRunning(edited)) running.start(timers, edited, Clock::now);
+                                journal.edit(oldName, timers, edited);
+                            }
                         }else {
-                            timers.push_back(Timer(timerInput.name, std::chrono::seconds{ total }, 
+                            TimerHandle added = timers.push_back(Timer(timerInput.name, std::chrono::seconds{ total }, 
                                 Color(timerInput.color[0], timerInput.color[1], timerInput.color[2]), 
-                                days, timerTypes[timerInput.timerTypeInd]
+                                days, period
                             ));
+                            if (added != NullTimer) journal.add(timers, timers.indexOf(added));
                         }
+                        edited_timer = NullTimer;
+                        timerInput = TimerInput{};
+                        ImGui::CloseCurrentPopup();
                     }
-                    edited_timer = nullptr;
-                    timerInput = TimerInput{};
-                    ImGui::CloseCurrentPopup();
                 }
                 ImGui::SameLine();
                 if (ImGui::Button("Cancel")) {
-                    edited_timer = nullptr;
+                    timerInputError = nullptr;
+                    edited_timer = NullTimer;
                     timerInput = TimerInput{};
                     ImGui::CloseCurrentPopup();
                 }
@@ -446,15 +543,19 @@ int main(int, char**)
 
         // Rendering
         ImGui::Render();
+        frameArena.reset();
+#ifdef TIMERWISE_COUNT_ALLOCS
+        frame_allocations = allocation_count - allocations_at_frame_start;
+#endif
         glViewport(0, 0, (int)io.DisplaySize.x, (int)io.DisplaySize.y);
         glClearColor(clear_color.x * clear_color.w, clear_color.y * clear_color.w, clear_color.z * clear_color.w, clear_color.w);
         glClear(GL_COLOR_BUFFER_BIT);
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
         SDL_GL_SwapWindow(window);
     }
-    save_timer_vec(timers, TimersFilePath);
-    auto date = std::to_string(Timer::cur_day) + " " + std::to_string(Timer::cur_week);
-    save_date(date, DaysFilePath);
+    writer.flush();
+    saveFiles(timers, journal, writer, true);
+    writer.flush();
 
     // Cleanup
     ImGui_ImplOpenGL3_Shutdown();
@@ -0,0 +1,335 @@
+// Round trips timers through every TimerEncoding and checks the loader on
+// hand-made files. Small enough to run on every build, see timerwise_bench
+// for the same checks at scale.
+// Usage: timerwise_tests
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "BinarySnapshot.h"
+#include "Journal.h"
+#include "Snapshot.h"
+#include "TimerWise.h"
+
+using json = nlohmann::json;
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& what) {
+    if (condition) return;
+    std::cerr << "FAILED: " << what << "\n";
+    failures++;
+}
+
+static Timer make_timer(std::string name, int64_t duration, int64_t timePassed, WeekDays days, Period period) {
+    Timer timer{std::move(name), std::chrono::seconds(duration), Color{0.25f, 0.5f, 1.f}, days, period};
+    timer.timePassed = std::chrono::seconds(timePassed);
+    return timer;
+}
+
+static std::vector<Timer> sample_timers() {
+    return {
+        make_timer("plain", 3600, 120, AllWeekDays, {PeriodType::Daily, 1}),
+        make_timer("quote \" backslash \\ tab \t newline \n", 60, 0, weekday_bit(1), {PeriodType::Weekly, 1}),
+        make_timer("control \x01\x1f", 90, 30, 0, {PeriodType::Monthly, 1}),
+        make_timer("Zürich ☕ 日本 😀", 45, 45, weekday_bit(0) | weekday_bit(6), {PeriodType::EveryNDays, 3}),
+        make_timer("every year", 7200, 0, AllWeekDays, {PeriodType::EveryNDays, 365}),
+        make_timer("longest interval", 1, 0, AllWeekDays, {PeriodType::EveryNDays, UINT16_MAX}),
+    };
+}
+
+static bool same_timers(const TimerStore& loaded, const std::vector<Timer>& expected) {
+    if (loaded.count() != expected.size()) return false;
+    for (size_t ind = 0; ind < expected.size(); ind++) {
+        if (loaded.get(ind).to_json() != expected[ind].to_json()) return false;
+    }
+    return true;
+}
+
+// The bytes save_timer_vec would write for j, built by hand so a file can hold
+// things the writers never produce
+static std::string encode(const json& j, TimerEncoding encoding) {
+    std::string out;
+    switch (encoding) {
+    case TimerEncoding::Json: return j.dump();
+    case TimerEncoding::Cbor:
+        out = "\xd9\xd9\xf7";
+        json::to_cbor(j, out);
+        return out;
+    case TimerEncoding::MessagePack:
+        json::to_msgpack(j, out);
+        return out;
+    case TimerEncoding::Ubjson:
+        json::to_ubjson(j, out, true);
+        return out;
+    }
+    return out;
+}
+
+static void write_file(const std::filesystem::path& path, const std::string& contents) {
+    std::ofstream f(path, std::ofstream::binary | std::ofstream::trunc);
+    f << contents;
+}
+
+static void test_round_trip(const std::filesystem::path& dir, TimerEncoding encoding) {
+    std::string name = TimerEncodingNames[int(encoding)];
+    auto path = dir / ("timers." + name);
+
+    check(save_timer_vec(std::vector<Timer>{}, path, encoding), name + ": saving no timers");
+    TimerStore empty;
+    LoadError error;
+    check(load_timer_vec(empty, path, &error) && empty.empty(), name + ": loading no timers " + error.message);
+
+    auto timers = sample_timers();
+    check(save_timer_vec(timers, path, encoding), name + ": saving");
+    TimerStore loaded;
+    check(load_timer_vec(loaded, path, &error), name + ": loading " + error.message);
+    check(same_timers(loaded, timers), name + ": timers changed in a round trip");
+
+    std::ifstream f(path, std::ifstream::binary);
+    check(detect_encoding(f) == encoding, name + ": detected as another encoding");
+}
+
+static void test_store_round_trip(const std::filesystem::path& dir, JsonStyle style) {
+    auto timers = sample_timers();
+    TimerStore store;
+    for (auto& timer : timers) store.push_back(timer);
+    auto path = dir / "store.json";
+
+    check(save_timer_vec(store, path, style), "store: saving");
+    TimerStore loaded;
+    LoadError error;
+    check(load_timer_vec(loaded, path, &error), "store: loading " + error.message);
+    check(same_timers(loaded, timers), "store: timers changed in a round trip");
+
+    TimerStore emptyStore;
+    check(save_timer_vec(emptyStore, path, style), "store: saving no timers");
+    TimerStore loadedEmpty;
+    check(load_timer_vec(loadedEmpty, path, &error) && loadedEmpty.empty(), "store: loading no timers");
+}
+
+static json timer_json(const std::string& name) {
+    return make_timer(name, 60, 0, AllWeekDays, {}).to_json();
+}
+
+static void test_unknown_keys(const std::filesystem::path& dir, TimerEncoding encoding) {
+    std::string name = TimerEncodingNames[int(encoding)];
+    json timer = timer_json("extra keys");
+    timer["null"] = nullptr;
+    timer["flag"] = true;
+    timer["note"] = "text";
+    timer["count"] = 3;
+    timer["nested"] = {{"list", {1, 2, {{"deep", nullptr}}}}, {"flag", false}};
+    // JSON has no binary type
+    if (encoding != TimerEncoding::Json) timer["blob"] = json::binary({1, 2, 3});
+    auto path = dir / ("unknown." + name);
+    write_file(path, encode(json::array({timer, timer_json("after")}), encoding));
+
+    TimerStore loaded;
+    LoadError error;
+    check(load_timer_vec(loaded, path, &error), name + ": unknown keys rejected: " + error.message);
+    check(loaded.count() == 2 && loaded.find("extra keys") != NullTimer && loaded.find("after") != NullTimer,
+          name + ": unknown keys lost a timer");
+}
+
+static void test_duplicate_names(const std::filesystem::path& dir, TimerEncoding encoding) {
+    std::string name = TimerEncodingNames[int(encoding)];
+    auto path = dir / ("duplicates." + name);
+    write_file(path, encode(json::array({timer_json("same"), timer_json("same"), timer_json("same (2)")}), encoding));
+
+    TimerStore loaded;
+    LoadError error;
+    check(load_timer_vec(loaded, path, &error), name + ": duplicates rejected: " + error.message);
+    check(loaded.count() == 3 && error.renamed == 2, name + ": duplicates were dropped");
+    check(loaded.find("same (2)") != NullTimer && loaded.find("same (2) (2)") != NullTimer,
+          name + ": duplicates not renamed");
+}
+
+static void test_truncated(const std::filesystem::path& dir, TimerEncoding encoding) {
+    std::string name = TimerEncodingNames[int(encoding)];
+    std::string bytes = encode(json::array({timer_json("complete"), timer_json("cut off")}), encoding);
+    bytes.resize(bytes.size() - 4);
+    auto path = dir / ("truncated." + name);
+    write_file(path, bytes);
+
+    TimerStore loaded;
+    LoadError error;
+    check(!load_timer_vec(loaded, path, &error), name + ": truncated file loaded");
+    check(!error.message.empty() && error.offset > bytes.size() / 2 && error.offset <= bytes.size() + 1,
+          name + ": error offset " + std::to_string(error.offset) + " outside the cut");
+    check(loaded.count() == 1, name + ": timers before the error were lost");
+}
+
+// Binary encodings carry any bytes as a name, the store only ever sees valid UTF-8
+static void test_invalid_utf8(const std::filesystem::path& dir, TimerEncoding encoding) {
+    std::string name = TimerEncodingNames[int(encoding)];
+    auto path = dir / ("invalid_utf8." + name);
+    write_file(path, encode(json::array({timer_json("bad \xfc name")}), encoding));
+    const std::string fixedName = "bad \xEF\xBF\xBD name";
+
+    TimerStore loaded;
+    LoadError error;
+    check(load_timer_vec(loaded, path, &error), name + ": invalid UTF-8 rejected: " + error.message);
+    TimerHandle handle = loaded.find(fixedName);
+    check(handle != NullTimer, name + ": invalid UTF-8 not replaced");
+    if (handle == NullTimer) return;
+
+    // Journaling the name used to throw type_error.316
+    auto journalPath = dir / "journal.jsonl";
+    std::filesystem::remove(journalPath);
+    size_t ind = loaded.indexOf(handle);
+    loaded.timePassed[ind] = std::chrono::seconds(42);
+    try {
+        Journal journal;
+        journal.open(journalPath);
+        journal.start(loaded, ind);
+        journal.pause(loaded, ind);
+        check(journal.records == 2, name + ": records not journaled");
+    } catch (const std::exception& ex) {
+        check(false, name + ": journaling threw " + ex.what());
+    }
+
+    // Replay finds the timer under the same name it was loaded with
+    TimerStore replayed;
+    load_timer_vec(replayed, path);
+    check(replay_journal(replayed, journalPath) == 2, name + ": journal didn't replay");
+    size_t replayedInd = replayed.indexOf(replayed.find(fixedName));
+    check(replayedInd != TimerStore::NotFound && replayed.timePassed[replayedInd] == std::chrono::seconds(42),
+          name + ": replay missed the timer");
+}
+
+static void put_le(std::string& out, uint64_t value, size_t bytes) {
+    for (size_t b = 0; b < bytes; b++) out.push_back(char(value >> (8 * b)));
+}
+
+// timers.bin as a later minor version would write it, with extra header and
+// record fields this reader doesn't know
+static std::string future_bin(const std::vector<Timer>& timers, uint32_t version) {
+    std::string current = TimerBin::encode(timers);
+    const uint32_t extraHeader = 8, extraRecord = 4;
+    std::string out(TimerBin::Magic, sizeof(TimerBin::Magic));
+    put_le(out, version, 4);
+    put_le(out, TimerBin::HeaderSize + extraHeader, 4);
+    put_le(out, TimerBin::RecordSize + extraRecord, 4);
+    put_le(out, timers.size(), 4);
+    out.append(current, 20, 8);
+    out.append(extraHeader, '\x7f');
+    for (size_t ind = 0; ind < timers.size(); ind++) {
+        out.append(current, TimerBin::HeaderSize + ind * TimerBin::RecordSize, TimerBin::RecordSize);
+        out.append(extraRecord, '\x7f');
+    }
+    out.append(current, TimerBin::HeaderSize + timers.size() * TimerBin::RecordSize);
+    return out;
+}
+
+static void test_bin_versions(const std::filesystem::path& dir) {
+    auto timers = sample_timers();
+    auto path = dir / "future.bin";
+
+    write_file(path, future_bin(timers, TimerBin::Major << 16 | (TimerBin::Minor + 1)));
+    TimerStore loaded;
+    check(load_timer_bin(loaded, path) && same_timers(loaded, timers), "bin: newer minor version not loaded");
+
+    write_file(path, future_bin(timers, (TimerBin::Major + 1) << 16 | TimerBin::Minor));
+    TimerStore rejected;
+    check(!load_timer_bin(rejected, path) && rejected.empty(), "bin: newer major version loaded");
+}
+
+// Checkpoints only write timers.bin, timers.json comes on exit or when timers.bin fails
+static void test_snapshot_files(const std::filesystem::path& dir) {
+    auto snapshotDir = dir / "snapshot";
+    std::filesystem::create_directories(snapshotDir);
+    auto jsonPath = snapshotDir / "timers.json";
+    auto binPath = snapshotDir / "timers.bin";
+    auto datePath = snapshotDir / "days.txt";
+    Snapshot snapshot{sample_timers(), "1 2 3 4"};
+
+    check(write_snapshot(snapshot, jsonPath, binPath, datePath), "snapshot: checkpoint failed");
+    check(!std::filesystem::exists(jsonPath) && std::filesystem::exists(binPath), "snapshot: checkpoint wrote timers.json");
+
+    snapshot.writeJson = true;
+    check(write_snapshot(snapshot, jsonPath, binPath, datePath), "snapshot: exit save failed");
+    TimerStore loaded;
+    check(load_timer_vec(loaded, jsonPath) && same_timers(loaded, snapshot.timers), "snapshot: exit save missed timers.json");
+
+    // A directory in the way of timers.bin
+    std::filesystem::remove_all(snapshotDir);
+    std::filesystem::create_directories(binPath / "blocked");
+    snapshot.writeJson = false;
+    check(write_snapshot(snapshot, jsonPath, binPath, datePath), "snapshot: no fallback when timers.bin failed");
+    TimerStore fallback;
+    check(load_timer_vec(fallback, jsonPath) && same_timers(fallback, snapshot.timers),
+          "snapshot: fallback timers.json is wrong");
+}
+
+// A running timer's progress is journaled without counting as a change
+static void test_progress_record(const std::filesystem::path& dir) {
+    auto journalPath = dir / "progress.jsonl";
+    std::filesystem::remove(journalPath);
+    VirtualClock clock{time(0), std::chrono::steady_clock::time_point{} + std::chrono::hours(1)};
+    Clock::use(clock);
+    Clock::tick();
+    TimerStore timers;
+    timers.push_back(make_timer("running", 3600, 10, AllWeekDays, {}));
+    RunningTimers running;
+    running.start(timers, 0, Clock::now);
+
+    Journal journal;
+    journal.open(journalPath);
+    journal.start(timers, 0);
+    clock.advance(std::chrono::seconds(30));
+    Clock::tick();
+    journal.progress(timers, 0);
+    check(journal.records == 2 && journal.changes == 1, "progress: counted as a change");
+    journal.out.close();
+
+    TimerStore replayed;
+    replayed.push_back(make_timer("running", 3600, 0, AllWeekDays, {}));
+    check(replay_journal(replayed, journalPath) == 2, "progress: journal didn't replay");
+    check(replayed.timePassed[0] == std::chrono::seconds(40), "progress: elapsed time lost on replay");
+
+    static SystemClock systemClock;
+    Clock::use(systemClock);
+    Clock::tick();
+}
+
+static void test_invalid_utf8_bin(const std::filesystem::path& dir) {
+    auto path = dir / "invalid_utf8.bin";
+    save_timer_bin({make_timer("bad \xfc name", 60, 0, AllWeekDays, {})}, path);
+    TimerStore loaded;
+    check(load_timer_bin(loaded, path) && loaded.find("bad \xEF\xBF\xBD name") != NullTimer,
+          "bin: invalid UTF-8 not replaced");
+
+    TimerBinView view;
+    TimerStore started;
+    TimerHandle materialized = view.open(path) ? view.materialize(started, 0) : NullTimer;
+    check(materialized != NullTimer && materialized == started.find("bad \xEF\xBF\xBD name"),
+          "bin: materialize kept invalid UTF-8");
+}
+
+int main() {
+    auto dir = std::filesystem::temp_directory_path() / "timerwise_tests";
+    std::filesystem::create_directories(dir);
+
+    for (int encodingInd = 0; encodingInd < 4; encodingInd++) {
+        auto encoding = TimerEncoding(encodingInd);
+        test_round_trip(dir, encoding);
+        test_unknown_keys(dir, encoding);
+        test_duplicate_names(dir, encoding);
+        test_truncated(dir, encoding);
+        if (encoding != TimerEncoding::Json) test_invalid_utf8(dir, encoding);
+    }
+    test_invalid_utf8_bin(dir);
+    test_progress_record(dir);
+    test_bin_versions(dir);
+    test_snapshot_files(dir);
+    test_store_round_trip(dir, JsonStyle::Pretty);
+    test_store_round_trip(dir, JsonStyle::Compact);
+
+    std::filesystem::remove_all(dir);
+    if (failures != 0) std::cerr << failures << " checks failed\n";
+    return failures == 0 ? 0 : 1;
+}